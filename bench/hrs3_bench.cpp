@@ -0,0 +1,381 @@
+/*
+ * hrs3_bench - Microbenchmarks of the hrs3 APIs.
+ *
+ * Each case evaluates one API on one schedule at one kind of time in
+ * one zone, repeating the call until it has run for --min-time-ms, and
+ * reports the time and the number of allocations per call.
+ *
+ *   hrs3_bench [--filter SUBSTRING] [--min-time-ms N] [--json]
+ *              [--baseline FILE] [--threshold PERCENT]
+ *
+ * --json writes the results as JSON, which can be saved and passed
+ * back as --baseline to compare a later build with.  Cases more than
+ * --threshold percent slower than the baseline are marked, and make
+ * the exit status 1.
+ */
+
+#include "hrs3cpp.h"
+#include "impl/os.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if __GLIBC__
+/*
+ * Count allocations by replacing malloc and friends, which glibc
+ * supports, so that allocations inside libc such as strdup's are
+ * counted too.
+ */
+static atomic<long> allocations(0);
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size)
+{
+  *p = memalign(alignment, size);
+  return *p ? 0 : ENOMEM;
+}
+
+void free(void *p)
+{
+  __libc_free(p);
+}
+}
+
+static long allocationCount() { return allocations.load(memory_order_relaxed); }
+static bool countsAllocations() { return true; }
+#else
+static long allocationCount() { return 0; }
+static bool countsAllocations() { return false; }
+#endif
+
+/* Keep results alive so that the calls aren't optimized away. */
+static volatile long long sink;
+
+struct Result {
+  string name;
+  long long iterations;
+  double nsPerOp;
+  double allocsPerOp;
+};
+
+struct Options {
+  Options() : minTimeMs(20), json(false), threshold(10) { }
+  string filter;
+  int minTimeMs;
+  bool json;
+  string baseline;
+  double threshold;
+};
+
+/*
+ * Run op in batches, doubling the batch until one takes at least
+ * minTimeMs, and report the last batch.
+ */
+template <class Op>
+static Result measure(const string &name, const Options &options, Op op)
+{
+  typedef chrono::steady_clock Clock;
+  Result result;
+  result.name = name;
+  long long n = 1;
+  for (;;) {
+    long before = allocationCount();
+    Clock::time_point start = Clock::now();
+    for (long long i = 0; i < n; ++i)
+      op();
+    double ns = chrono::duration<double, nano>(Clock::now() - start).count();
+    long allocs = allocationCount() - before;
+    if (options.minTimeMs * 1e6 <= ns || (1LL << 40) <= n) {
+      result.iterations = n;
+      result.nsPerOp = ns / n;
+      result.allocsPerOp = countsAllocations() ? (double)allocs / n : -1;
+      return result;
+    }
+    n *= 2;
+  }
+}
+
+struct Schedule {
+  string name;
+  string hrsss;
+};
+
+/* n shifts of 5 minutes, 14 minutes apart */
+static string manyShifts(const char *days, int n)
+{
+  string s = days;
+  char buf[32];
+  for (int i = 0; i < n; ++i) {
+    int start = 14 * i, stop = start + 5;
+    snprintf(buf, sizeof(buf), "%s%02d%02d-%02d%02d", i ? "&" : "",
+             start / 60, start % 60, stop / 60, stop % 60);
+    s += buf;
+  }
+  return s;
+}
+
+static vector<Schedule> schedules()
+{
+  vector<Schedule> v;
+  Schedule daily = { "daily", "9-17" };
+  Schedule weekly = { "weekly", "MWF10-12&13-17.T8-9" };
+  Schedule raw = { "raw", "20150609120000-20150609130000" };
+  Schedule now = { "now", "now+1h" };
+  v.push_back(daily);
+  v.push_back(weekly);
+  v.push_back(raw);
+  v.push_back(now);
+  static const int counts[] = { 1, 10, 100 };
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "daily_%d", counts[i]);
+    Schedule d = { name, manyShifts("", counts[i]) };
+    v.push_back(d);
+    snprintf(name, sizeof(name), "weekly_%d", counts[i]);
+    Schedule w = { name, manyShifts("MTWRF", counts[i]) };
+    v.push_back(w);
+  }
+  return v;
+}
+
+struct When {
+  string name;
+  time_t t;
+};
+
+static time_t localTime(int year, int mon, int mday, int hour, int min, int sec)
+{
+  struct tm ymdhms = tm();
+  ymdhms.tm_year = year - 1900;
+  ymdhms.tm_mon = mon - 1;
+  ymdhms.tm_mday = mday;
+  ymdhms.tm_hour = hour;
+  ymdhms.tm_min = min;
+  ymdhms.tm_sec = sec;
+  ymdhms.tm_isdst = -1;
+  return mktime(&ymdhms);
+}
+
+/* Times of interest in the zone in TZ, in 2015. */
+static vector<When> whens()
+{
+  vector<When> v;
+  When midday = { "midday", localTime(2015, 6, 10, 12, 0, 0) };
+  When midnight = { "midnight", localTime(2015, 6, 9, 23, 59, 59) };
+  When endOfWeek = { "end_of_week", localTime(2015, 6, 13, 23, 59, 59) };
+  v.push_back(midday);
+  v.push_back(midnight);
+  v.push_back(endOfWeek);
+  /* just before the first change of UTC offset, if the zone has one */
+  time_t t = localTime(2015, 1, 1, 0, 0, 0);
+  struct tm ymdhms;
+  LOCALTIME_R(&t, &ymdhms);
+  int isdst = ymdhms.tm_isdst;
+  for (time_t stop = t + 366 * 24 * 3600; t < stop; t += 900) {
+    LOCALTIME_R(&t, &ymdhms);
+    if (ymdhms.tm_isdst != isdst) {
+      When dst = { "dst", t - 901 };
+      v.push_back(dst);
+      break;
+    }
+  }
+  return v;
+}
+
+static void setTz(const char *tz)
+{
+#if _WIN32
+  _putenv_s("TZ", tz);
+#else
+  setenv("TZ", tz, 1);
+#endif
+  tzset();
+}
+
+static void run(const Options &options, vector<Result> &results)
+{
+  static const char *zones[] = {
+    "UTC", "America/Los_Angeles", "Europe/Berlin", "Australia/Lord_Howe"
+  };
+  vector<Schedule> ss = schedules();
+  for (size_t i = 0; i < ss.size(); ++i) {
+    const char *hrsss = ss[i].hrsss.c_str();
+    string name = "kind_as_string/" + ss[i].name;
+    if (string::npos != name.find(options.filter))
+      results.push_back(measure(name, options, [&] {
+        sink += (long long)(size_t)hrs3_kind_as_string(hrsss);
+      }));
+  }
+  for (size_t z = 0; z < sizeof(zones) / sizeof(zones[0]); ++z) {
+    setTz(zones[z]);
+    vector<When> ws = whens();
+    for (size_t i = 0; i < ss.size(); ++i) {
+      const char *hrsss = ss[i].hrsss.c_str();
+      Hrs3 hrs3(ss[i].hrsss);
+      for (size_t j = 0; j < ws.size(); ++j) {
+        time_t t = ws[j].t;
+        string suffix = "/" + ss[i].name + "/" + ws[j].name + "/" + zones[z];
+        if (string::npos != ("remaining_in" + suffix).find(options.filter))
+          results.push_back(measure("remaining_in" + suffix, options, [&] {
+            sink += hrs3_remaining_in(hrsss, t);
+          }));
+        if (string::npos != ("remaining_out" + suffix).find(options.filter))
+          results.push_back(measure("remaining_out" + suffix, options, [&] {
+            sink += hrs3_remaining_out(hrsss, t);
+          }));
+        if (string::npos != ("Hrs3::remainingIn" + suffix).find(options.filter))
+          results.push_back(measure("Hrs3::remainingIn" + suffix, options, [&] {
+            sink += hrs3.remainingIn(t);
+          }));
+        if (string::npos != ("Hrs3::aggTime" + suffix).find(options.filter))
+          results.push_back(measure("Hrs3::aggTime" + suffix, options, [&] {
+            sink += hrs3.aggTime(t, 7 * 24 * 3600).timeIn();
+          }));
+      }
+      /* a clock ticking from midday, once per call */
+      string suffix = "/" + ss[i].name + "/ticking/" + zones[z];
+      hrs3_compiled *compiled = hrs3_compile(hrsss);
+      if (string::npos != ("compiled_remaining" + suffix).find(options.filter)) {
+        time_t t = ws[0].t;
+        results.push_back(measure("compiled_remaining" + suffix, options, [&] {
+          sink += hrs3_compiled_remaining(compiled, t++).seconds;
+        }));
+      }
+      if (string::npos != ("cursor_remaining" + suffix).find(options.filter)) {
+        time_t t = ws[0].t;
+        hrs3_cursor *cursor = hrs3_cursor_open(compiled);
+        results.push_back(measure("cursor_remaining" + suffix, options, [&] {
+          sink += hrs3_cursor_remaining(cursor, t++).seconds;
+        }));
+        hrs3_cursor_close(cursor);
+      }
+      hrs3_compiled_free(compiled);
+    }
+  }
+}
+
+static void printJson(const vector<Result> &results)
+{
+  printf("{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    printf("    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.2f, "
+           "\"allocs_per_op\": %.2f}%s\n", r.name.c_str(), r.iterations, r.nsPerOp,
+           r.allocsPerOp, i + 1 < results.size() ? "," : "");
+  }
+  printf("  ]\n}\n");
+}
+
+/* Read the ns/op of each case from JSON written by printJson. */
+static bool readBaseline(const string &path, map<string, double> &baseline)
+{
+  ifstream in(path.c_str());
+  if (!in)
+    return false;
+  string line;
+  while (getline(in, line)) {
+    size_t name = line.find("\"name\": \"");
+    size_t ns = line.find("\"ns_per_op\": ");
+    if (string::npos == name || string::npos == ns)
+      continue;
+    name += strlen("\"name\": \"");
+    size_t end = line.find('"', name);
+    baseline[line.substr(name, end - name)] = atof(line.c_str() + ns + strlen("\"ns_per_op\": "));
+  }
+  return true;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: hrs3_bench [--filter SUBSTRING] [--min-time-ms N] [--json]\n"
+          "                  [--baseline FILE] [--threshold PERCENT]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if ("--filter" == arg && hasValue)
+      options.filter = argv[++i];
+    else if ("--min-time-ms" == arg && hasValue)
+      options.minTimeMs = atoi(argv[++i]);
+    else if ("--json" == arg)
+      options.json = true;
+    else if ("--baseline" == arg && hasValue)
+      options.baseline = argv[++i];
+    else if ("--threshold" == arg && hasValue)
+      options.threshold = atof(argv[++i]);
+    else
+      usage();
+  }
+  map<string, double> baseline;
+  if (!options.baseline.empty() && !readBaseline(options.baseline, baseline)) {
+    fprintf(stderr, "hrs3_bench: can't read %s\n", options.baseline.c_str());
+    return 2;
+  }
+  vector<Result> results;
+  run(options, results);
+  if (options.json) {
+    printJson(results);
+    return 0;
+  }
+  int regressions = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    printf("%-60s %10.1f ns/op %8.2f allocs/op", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+    map<string, double>::const_iterator b = baseline.find(r.name);
+    if (b != baseline.end() && 0 < b->second) {
+      double change = 100 * (r.nsPerOp - b->second) / b->second;
+      bool isRegression = options.threshold < change;
+      regressions += isRegression;
+      printf(" %+7.1f%%%s", change, isRegression ? " SLOWER" : "");
+    }
+    printf("\n");
+  }
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * hrs3_scale - How evaluation throughput scales with threads.
+ *
+ * Each case runs one API on a weekly, raw or now schedule on 1, 2, 4,
+ * ... up to --threads threads for --ms milliseconds, either on one
+ * schedule that every thread shares or on a schedule of each thread's
+ * own, and reports the total and per-thread throughput and the
+ * latency percentiles of a sample of the calls.  remaining_in_tz
+ * threads that don't share a schedule don't share a zone either.  Per-thread throughput that falls as threads are added
+ * points at state the threads contend for.
+ *
+ *   hrs3_scale [--threads N] [--ms N] [--filter SUBSTRING] [--json]
+ */
+
+#include "hrs3cpp.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef chrono::steady_clock Clock;
+
+/* Time one call in this many. */
+#define SAMPLE_EVERY 16
+
+struct Options {
+  Options() : threads(thread::hardware_concurrency()), ms(200), json(false) { }
+  int threads;
+  int ms;
+  string filter;
+  bool json;
+};
+
+struct Result {
+  string name;
+  int threads;
+  double opsPerSecond;
+  double p50Ns;
+  double p99Ns;
+  double p999Ns;
+};
+
+static const char *kinds[] = { "weekly", "raw", "now" };
+
+/* The schedule of thread i, the same for every thread if shared. */
+static string scheduleFor(const string &kind, bool shared, int i)
+{
+  char buf[64];
+  if ("raw" == kind)
+    snprintf(buf, sizeof(buf), "20150601000000-2015%02d01000000", shared ? 12 : 7 + i % 6);
+  else if ("now" == kind)
+    snprintf(buf, sizeof(buf), "now+%dm", shared ? 90 : 1 + i);
+  else if (shared)
+    return "MTWRF9-12&13-17.A10-14";
+  else
+    snprintf(buf, sizeof(buf), "MTWRF9-12&13-17.A10-14&%02d%02d-23", 15 + i / 60 % 8, i % 60);
+  return buf;
+}
+
+/*
+ * Per thread, the state for evaluating its schedule with one API.
+ * call evaluates at time t.
+ */
+struct Evaluator {
+  virtual ~Evaluator() { }
+  virtual long long call(time_t t) = 0;
+};
+
+struct RemainingIn : Evaluator {
+  RemainingIn(const string &hrsss) : _hrsss(hrsss) { }
+  long long call(time_t t) { return hrs3_remaining_in(_hrsss.c_str(), t); }
+  string _hrsss;
+};
+
+struct RemainingInTz : Evaluator {
+  RemainingInTz(const string &hrsss, const char *zone) : _hrsss(hrsss), _zone(zone) { }
+  long long call(time_t t) { return hrs3_remaining_in_tz(_hrsss.c_str(), _zone, t); }
+  string _hrsss;
+  const char *_zone;
+};
+
+struct CompiledRemaining : Evaluator {
+  CompiledRemaining(hrs3_compiled *compiled) : _compiled(compiled) { }
+  long long call(time_t t) { return hrs3_compiled_remaining(_compiled, t).seconds; }
+  hrs3_compiled *_compiled;
+};
+
+struct Hrs3RemainingIn : Evaluator {
+  Hrs3RemainingIn(const Hrs3 &hrs3) : _hrs3(hrs3) { }
+  long long call(time_t t) { return _hrs3.remainingIn(t); }
+  const Hrs3 &_hrs3;
+};
+
+struct Hrs3AggTime : Evaluator {
+  Hrs3AggTime(const Hrs3 &hrs3) : _hrs3(hrs3) { }
+  long long call(time_t t) { return _hrs3.aggTime(t, 24 * 3600).timeIn(); }
+  const Hrs3 &_hrs3;
+};
+
+enum Api { RemainingInApi, RemainingInTzApi, CompiledApi, Hrs3Api, AggTimeApi };
+static const char *apiNames[] = {
+  "remaining_in", "remaining_in_tz", "compiled_remaining", "Hrs3::remainingIn",
+  "Hrs3::aggTime"
+};
+
+/* The zone of thread i for remaining_in_tz, the same for every thread if shared. */
+static const char *zoneFor(bool shared, int i)
+{
+  static const char *zones[] = {
+    "America/Los_Angeles", "Europe/Berlin", "Australia/Lord_Howe", "UTC"
+  };
+  return zones[shared ? 0 : i % (sizeof(zones) / sizeof(zones[0]))];
+}
+
+static string caseName(int api, const string &kind, bool shared)
+{
+  return string(apiNames[api]) + "/" + kind + (shared ? "/shared" : "/per_thread");
+}
+
+static Result runCase(Api api, const string &kind, bool shared, int n_threads,
+                      const Options &options)
+{
+  vector<string> hrsss;
+  vector<hrs3_compiled *> compiled;
+  vector<Hrs3> hrs3s;
+  for (int i = 0; i < n_threads; ++i) {
+    hrsss.push_back(scheduleFor(kind, shared, i));
+    compiled.push_back(hrs3_compile(hrsss.back().c_str()));
+    hrs3s.push_back(Hrs3(hrsss.back()));
+  }
+  atomic<bool> go(false), stop(false);
+  atomic<long long> ops(0);
+  vector<vector<double> > samples(n_threads);
+  vector<thread> threads;
+  for (int i = 0; i < n_threads; ++i) {
+    threads.push_back(thread([&, i] {
+      Evaluator *evaluator;
+      switch (api) {
+      case RemainingInApi: evaluator = new RemainingIn(hrsss[i]); break;
+      case RemainingInTzApi: evaluator = new RemainingInTz(hrsss[i], zoneFor(shared, i)); break;
+      case CompiledApi: evaluator = new CompiledRemaining(compiled[i]); break;
+      case Hrs3Api: evaluator = new Hrs3RemainingIn(hrs3s[i]); break;
+      default: evaluator = new Hrs3AggTime(hrs3s[i]); break;
+      }
+      vector<double> &mine = samples[i];
+      mine.reserve(1 << 20);
+      long long sink = 0, n = 0;
+      time_t t = 1433116800 + 7919 * i; /* 2015-06-01 */
+      while (!go.load(memory_order_acquire))
+        ;
+      while (!stop.load(memory_order_relaxed)) {
+        t += 677;
+        if (0 == n % SAMPLE_EVERY && mine.size() < mine.capacity()) {
+          Clock::time_point start = Clock::now();
+          sink += evaluator->call(t);
+          mine.push_back(chrono::duration<double, nano>(Clock::now() - start).count());
+        } else {
+          sink += evaluator->call(t);
+        }
+        ++n;
+      }
+      ops.fetch_add(n + (sink & 0), memory_order_relaxed);
+      delete evaluator;
+    }));
+  }
+  Clock::time_point start = Clock::now();
+  go.store(true, memory_order_release);
+  this_thread::sleep_for(chrono::milliseconds(options.ms));
+  stop.store(true);
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+  double seconds = chrono::duration<double>(Clock::now() - start).count();
+  for (size_t i = 0; i < compiled.size(); ++i)
+    hrs3_compiled_free(compiled[i]);
+  vector<double> all;
+  for (size_t i = 0; i < samples.size(); ++i)
+    all.insert(all.end(), samples[i].begin(), samples[i].end());
+  sort(all.begin(), all.end());
+  Result result;
+  result.name = caseName(api, kind, shared);
+  result.threads = n_threads;
+  result.opsPerSecond = ops.load() / seconds;
+  result.p50Ns = all.empty() ? 0 : all[all.size() / 2];
+  result.p99Ns = all.empty() ? 0 : all[all.size() * 99 / 100];
+  result.p999Ns = all.empty() ? 0 : all[all.size() * 999 / 1000];
+  return result;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: hrs3_scale [--threads N] [--ms N] [--filter SUBSTRING] [--json]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if ("--threads" == arg && hasValue)
+      options.threads = atoi(argv[++i]);
+    else if ("--ms" == arg && hasValue)
+      options.ms = atoi(argv[++i]);
+    else if ("--filter" == arg && hasValue)
+      options.filter = argv[++i];
+    else if ("--json" == arg)
+      options.json = true;
+    else
+      usage();
+  }
+  if (options.threads < 1)
+    options.threads = 1;
+  vector<Result> results;
+  for (int api = 0; api < (int)(sizeof(apiNames) / sizeof(apiNames[0])); ++api) {
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+      for (int shared = 1; 0 <= shared; --shared) {
+        if (string::npos == caseName(api, kinds[k], shared).find(options.filter))
+          continue;
+        for (int n = 1; ; n = n * 2 < options.threads ? n * 2 : options.threads) {
+          results.push_back(runCase((Api)api, kinds[k], shared, n, options));
+          const Result &r = results.back();
+          if (!options.json)
+            printf("%-36s %3d threads %12.0f ops/s %12.0f ops/s/thread "
+                   "p50 %7.0f ns p99 %7.0f ns p99.9 %8.0f ns\n",
+                   r.name.c_str(), r.threads, r.opsPerSecond, r.opsPerSecond / r.threads,
+                   r.p50Ns, r.p99Ns, r.p999Ns);
+          if (n == options.threads)
+            break;
+        }
+      }
+    }
+  }
+  if (options.json) {
+    printf("{\n  \"scaling\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result &r = results[i];
+      printf("    {\"name\": \"%s\", \"threads\": %d, \"ops_per_second\": %.0f, "
+             "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f}%s\n",
+             r.name.c_str(), r.threads, r.opsPerSecond, r.p50Ns, r.p99Ns, r.p999Ns,
+             i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+  }
+  return 0;
+}
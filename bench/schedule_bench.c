@@ -0,0 +1,145 @@
+/*
+ * schedule_bench - Building a schedule from many ranges.
+ *
+ * Each case builds a schedule from n ranges in random order, some of
+ * which overlap, either inserting them one at a time with
+ * schedule_insert or adding them all at once with
+ * schedule_insert_many, and reports the time per build and per range.
+ * Inserting one at a time is quadratic, so it stops short of the
+ * largest n.
+ *
+ *   schedule_bench [--filter SUBSTRING] [--min-time-ms N] [--json]
+ */
+
+#include "../hrs3.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Keep results alive so that the builds aren't optimized away. */
+static volatile int sink;
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return 1e9 * ts.tv_sec + ts.tv_nsec;
+}
+
+/* n ranges of a minute, starting at random within 2n minutes */
+static a_time_range *random_ranges(int n)
+{
+  a_time_range *ranges = malloc(sizeof(a_time_range) * n);
+  a_time start;
+  time_init(&start, 1433116800); /* 2015-06-01 */
+  unsigned int seed = 12345;
+  int i = 0;
+  for (; i < n; ++i) {
+    seed = seed * 1103515245 + 12345;
+    a_time t = time_plus(&start, 60 * (int)((seed >> 8) % (2 * n)));
+    time_range_init(&ranges[i], &t, 60);
+  }
+  return ranges;
+}
+
+static void build_one_at_a_time(a_time_range *ranges, int n)
+{
+  a_schedule schedule;
+  schedule_init(&schedule);
+  int i = 0;
+  for (; i < n; ++i)
+    schedule_insert(&schedule, &ranges[i]);
+  sink += schedule.n_ranges;
+  schedule_destroy(&schedule);
+}
+
+static void build_at_once(a_time_range *ranges, int n)
+{
+  a_schedule schedule;
+  schedule_init(&schedule);
+  schedule_insert_many(&schedule, ranges, n);
+  sink += schedule.n_ranges;
+  schedule_destroy(&schedule);
+}
+
+typedef struct a_case {
+  const char *name;
+  void (*build)(a_time_range *ranges, int n);
+  int max_n;
+} a_case;
+
+static const a_case cases[] = {
+  { "schedule_insert", build_one_at_a_time, 1000 },
+  { "schedule_insert_many", build_at_once, 100000 }
+};
+
+static const int ns[] = { 10, 1000, 100000 };
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: schedule_bench [--filter SUBSTRING] [--min-time-ms N] [--json]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  const char *filter = "";
+  int min_time_ms = 20;
+  bool json = false;
+  int i = 1;
+  for (; i < argc; ++i) {
+    if (!strcmp("--filter", argv[i]) && i + 1 < argc)
+      filter = argv[++i];
+    else if (!strcmp("--min-time-ms", argv[i]) && i + 1 < argc)
+      min_time_ms = atoi(argv[++i]);
+    else if (!strcmp("--json", argv[i]))
+      json = true;
+    else
+      usage();
+  }
+  if (json)
+    printf("{\n  \"benchmarks\": [");
+  int n_results = 0;
+  size_t c = 0;
+  for (; c < DIM(cases); ++c) {
+    size_t j = 0;
+    for (; j < DIM(ns); ++j) {
+      int n = ns[j];
+      char name[64];
+      snprintf(name, sizeof(name), "%s/%d", cases[c].name, n);
+      if (cases[c].max_n < n || !strstr(name, filter))
+        continue;
+      a_time_range *ranges = random_ranges(n);
+      /* double the builds until they take at least min_time_ms */
+      long long iterations = 1;
+      double ns_per_op;
+      for (;;) {
+        double start = now_ns();
+        long long k = 0;
+        for (; k < iterations; ++k)
+          cases[c].build(ranges, n);
+        double elapsed = now_ns() - start;
+        if (min_time_ms * 1e6 <= elapsed || (1LL << 40) <= iterations) {
+          ns_per_op = elapsed / iterations;
+          break;
+        }
+        iterations *= 2;
+      }
+      free(ranges);
+      if (json)
+        printf("%s\n    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.2f}",
+               n_results ? "," : "", name, iterations, ns_per_op);
+      else
+        printf("%-32s %14.1f ns/op %10.1f ns/range\n", name, ns_per_op, ns_per_op / n);
+      ++n_results;
+    }
+  }
+  if (json)
+    printf("\n  ]\n}\n");
+  return 0;
+}
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -O2 -o schedule_bench schedule_bench.c && ./schedule_bench"
+ * End:
+ */
@@ -1,13 +1,10 @@
 #ifndef __hrs3_c__
 #define __hrs3_c__
 
+#include "hrs3.h"
 #include "impl/impl.h"
 #include <string.h>
 
-#if _WIN32
-#define strdup _strdup
-#endif
-
 /*
  * hrs3_remaining evaluates whether t falls within the schedule noted
  * by hrsss.  The return value x indicates both (a) whether t is within
@@ -15,35 +12,131 @@
  * valid.  A return value of -1 indicates an error.  Otherwise, the
  * high bit of x indicates (a), and all other bits indicate (b).
  */
-static a_remaining_result hrs3_remaining__(const char *hrsss, time_t time)
+static a_remaining_result hrs3_remaining__(const char *hrsss, size_t len, time_t time)
 {
   a_hrs3 hrs3;
-  if (OK != hrs3_init(&hrs3, hrsss, strlen(hrsss)))
+  a_remaining_result result = remaining_invalid();
+  arena_begin();
+  if (OK == hrs3_init(&hrs3, hrsss, len)) {
+    a_time t;
+    time_init(&t, time);
+    result = hrs3_remaining(&hrs3, &t);
+    hrs3_destroy(&hrs3);
+  }
+  arena_end();
+  return result;
+}
+
+/*
+ * hrs3_cache_key returns the key that hrsss is cached by, which
+ * leaves out any ':' characters, such as those in "9:00-10:00", so
+ * that it is the same as "900-1000".  Those are copied into buf, and
+ * keys too long for it aren't cached.
+ */
+#define HRS3_KEY_SIZE 256
+
+static const char *hrs3_cache_key(const char *hrsss, size_t *len, char *buf)
+{
+  if (!strnchr(hrsss, *len, ':'))
+    return hrsss;
+  const char *end = hrsss + *len;
+  size_t n = 0;
+  for (; hrsss < end; ++hrsss) {
+    if (':' == *hrsss)
+      continue;
+    if (HRS3_KEY_SIZE <= n)
+      return 0;
+    buf[n++] = *hrsss;
+  }
+  *len = n;
+  return buf;
+}
+
+static a_cache hrs3_cache = CACHE_INITIALIZER;
+
+/* The length of s, a NUL-terminated string or null. */
+static size_t hrs3_len(const char *s)
+{
+  return s ? strlen(s) : 0;
+}
+
+static a_remaining_result hrs3_remaining_n_(const char *hrsss, size_t len, time_t time)
+{
+  if (!hrsss)
     return remaining_invalid();
-  a_time t;
-  time_init(&t, time);
-  a_remaining_result result = hrs3_remaining(&hrs3, &t);
-  hrs3_destroy(&hrs3);
+  a_remaining_result result;
+  char buf[HRS3_KEY_SIZE];
+  size_t key_len = len;
+  const char *key = ATOMIC_LOAD(&hrs3_cache.enabled) ? hrs3_cache_key(hrsss, &key_len, buf) : 0;
+  const a_cache_entry *entry = key ? cache_acquire(&hrs3_cache, key, key_len) : 0;
+  if (entry) {
+    a_time t;
+    time_init(&t, time);
+    result = entry->is_valid ? compiled_remaining(&entry->compiled, &t) : remaining_invalid();
+    cache_release(&hrs3_cache, entry);
+  } else {
+    result = hrs3_remaining__(hrsss, len, time);
+  }
   return result;
 }
 
-static a_remaining_result hrs3_remaining_(const char *hrsss_in, time_t time)
+static a_remaining_result hrs3_remaining_(const char *hrsss, time_t time)
 {
-  const char *hrsss = hrsss_in;
-  if (strchr(hrsss_in, ':')) {
-    char *s = strdup(hrsss_in);
-    remove_char(s, ':');
-    hrsss = s;
+  return hrs3_remaining_n_(hrsss, hrs3_len(hrsss), time);
+}
+
+/*
+ * hrs3_remaining_tz_ is hrs3_remaining_ in the zone named by 'zone',
+ * or in the zone of TZ if zone is null.
+ */
+static a_remaining_result hrs3_remaining_tz_(const char *hrsss, size_t len,
+                                             const char *zone, time_t time)
+{
+  if (!zone)
+    return hrs3_remaining_n_(hrsss, len, time);
+  const a_tz *tz = tz_get_zone(zone);
+  if (!tz)
+    return remaining_invalid();
+  const a_tz *was = tz_set_local(tz);
+  a_remaining_result result = hrs3_remaining_n_(hrsss, len, time);
+  tz_set_local(was);
+  return result;
+}
+
+static hrs3_result hrs3_result_from(a_remaining_result remaining)
+{
+  hrs3_result result = { 0, 0, -1 };
+  if (remaining.is_valid) {
+    result.is_valid = 1;
+    result.is_in = remaining.time_is_in_schedule;
+    result.seconds = remaining.seconds;
   }
-  a_remaining_result result = hrs3_remaining__(hrsss, time);
-  if (hrsss != hrsss_in)
-    free((char *)hrsss);
   return result;
 }
 
+static a_hrs3_kind hrs3_kind_cached(const char *hrsss, size_t len)
+{
+  if (!hrsss || !ATOMIC_LOAD(&hrs3_cache.enabled))
+    return hrs3_kind(hrsss, len);
+  char buf[HRS3_KEY_SIZE];
+  size_t key_len = len;
+  const char *key = hrs3_cache_key(hrsss, &key_len, buf);
+  const a_cache_entry *entry = key ? cache_peek(&hrs3_cache, key, key_len) : 0;
+  if (!entry)
+    return hrs3_kind(hrsss, len);
+  /* a string that doesn't compile may still look like some kind */
+  a_hrs3_kind kind = entry->is_valid ? entry->compiled.hrs3.kind : hrs3_kind(hrsss, len);
+  cache_release(&hrs3_cache, entry);
+  return kind;
+}
+
 const char *hrs3_kind_as_string(const char *hrsss)
 {
-  a_hrs3_kind kind = hrs3_kind(hrsss);
+  return hrs3_kind_as_string_n(hrsss, hrs3_len(hrsss));
+}
+
+static const char *hrs3_kind_name(a_hrs3_kind kind)
+{
   switch (kind) {
   case Unknown: return "unknown";
   case Invalid: return "invalid";
@@ -57,9 +150,13 @@ const char *hrs3_kind_as_string(const char *hrsss)
   return "unknown";
 }
 
-int hrs3_remaining_in(const char *hrsss, time_t t)
+const char *hrs3_kind_as_string_n(const char *hrsss, size_t len)
+{
+  return hrs3_kind_name(hrs3_kind_cached(hrsss, len));
+}
+
+static int hrs3_in(a_remaining_result result)
 {
-  a_remaining_result result = hrs3_remaining_(hrsss, t);
   if (!result.is_valid)
     return -1;
   if (result.time_is_in_schedule)
@@ -67,9 +164,8 @@ int hrs3_remaining_in(const char *hrsss, time_t t)
   return 0;
 }
 
-int hrs3_remaining_out(const char *hrsss, time_t t)
+static int hrs3_out(a_remaining_result result)
 {
-  a_remaining_result result = hrs3_remaining_(hrsss, t);
   if (!result.is_valid)
     return -1;
   if (result.time_is_in_schedule)
@@ -77,6 +173,434 @@ int hrs3_remaining_out(const char *hrsss, time_t t)
   return result.seconds;
 }
 
+int hrs3_remaining_in(const char *hrsss, time_t t)
+{
+  return hrs3_in(hrs3_remaining_(hrsss, t));
+}
+
+int hrs3_remaining_out(const char *hrsss, time_t t)
+{
+  return hrs3_out(hrs3_remaining_(hrsss, t));
+}
+
+int hrs3_remaining_in_n(const char *hrsss, size_t len, time_t t)
+{
+  return hrs3_in(hrs3_remaining_n_(hrsss, len, t));
+}
+
+int hrs3_remaining_out_n(const char *hrsss, size_t len, time_t t)
+{
+  return hrs3_out(hrs3_remaining_n_(hrsss, len, t));
+}
+
+int hrs3_remaining_in_tz(const char *hrsss, const char *zone, time_t t)
+{
+  return hrs3_in(hrs3_remaining_tz_(hrsss, hrs3_len(hrsss), zone, t));
+}
+
+int hrs3_remaining_out_tz(const char *hrsss, const char *zone, time_t t)
+{
+  return hrs3_out(hrs3_remaining_tz_(hrsss, hrs3_len(hrsss), zone, t));
+}
+
+int hrs3_remaining_in_tz_n(const char *hrsss, size_t len, const char *zone, time_t t)
+{
+  return hrs3_in(hrs3_remaining_tz_(hrsss, len, zone, t));
+}
+
+int hrs3_remaining_out_tz_n(const char *hrsss, size_t len, const char *zone, time_t t)
+{
+  return hrs3_out(hrs3_remaining_tz_(hrsss, len, zone, t));
+}
+
+/*
+ * Compiled schedules are interned, so an hrs3_compiled is shared by
+ * everyone who compiled the same schedule in the same zone, however
+ * they wrote it, and is immutable.
+ */
+struct hrs3_compiled {
+  a_intern_entry entry;
+};
+
+static a_intern hrs3_intern = INTERN_INITIALIZER;
+
+hrs3_compiled *hrs3_compile(const char *hrsss)
+{
+  return hrs3_compile_tz_n(hrsss, hrs3_len(hrsss), 0);
+}
+
+hrs3_compiled *hrs3_compile_n(const char *hrsss, size_t len)
+{
+  return hrs3_compile_tz_n(hrsss, len, 0);
+}
+
+hrs3_compiled *hrs3_compile_tz(const char *hrsss, const char *zone)
+{
+  return hrs3_compile_tz_n(hrsss, hrs3_len(hrsss), zone);
+}
+
+hrs3_compiled *hrs3_compile_tz_n(const char *hrsss, size_t len, const char *zone)
+{
+  if (!hrsss)
+    return 0;
+  const a_tz *tz = 0;
+  if (zone && !(tz = tz_get_zone(zone)))
+    return 0;
+  const a_intern_entry *entry = intern_find(&hrs3_intern, hrsss, len, tz);
+  if (entry)
+    return (hrs3_compiled *)entry;
+  a_compiled compiled;
+  const a_tz *was = tz ? tz_set_local(tz) : 0;
+  if (OK == compiled_init(&compiled, hrsss, len))
+    entry = intern_add(&hrs3_intern, &compiled, tz);
+  if (tz)
+    tz_set_local(was);
+  return (hrs3_compiled *)entry;
+}
+
+/* b is null for the complement of a */
+static hrs3_compiled *hrs3_compiled_combine(const hrs3_compiled *a, const hrs3_compiled *b,
+                                            a_compiled_op op)
+{
+  if (!a || (b && a->entry.tz != b->entry.tz))
+    return 0;
+  a_compiled compiled;
+  status s = b
+    ? compiled_combine(&compiled, &a->entry.compiled, &b->entry.compiled, op)
+    : compiled_complement(&compiled, &a->entry.compiled);
+  if (OK != s)
+    return 0;
+  return (hrs3_compiled *)intern_add(&hrs3_intern, &compiled, a->entry.tz);
+}
+
+hrs3_compiled *hrs3_compiled_union(const hrs3_compiled *a, const hrs3_compiled *b)
+{
+  return b ? hrs3_compiled_combine(a, b, Union) : 0;
+}
+
+hrs3_compiled *hrs3_compiled_intersection(const hrs3_compiled *a, const hrs3_compiled *b)
+{
+  return b ? hrs3_compiled_combine(a, b, Intersection) : 0;
+}
+
+hrs3_compiled *hrs3_compiled_difference(const hrs3_compiled *a, const hrs3_compiled *b)
+{
+  return b ? hrs3_compiled_combine(a, b, Difference) : 0;
+}
+
+hrs3_compiled *hrs3_compiled_complement(const hrs3_compiled *a)
+{
+  return hrs3_compiled_combine(a, 0, Difference);
+}
+
+/* The key of an interned schedule is its canonical form. */
+int hrs3_compiled_format(const hrs3_compiled *compiled, char *buf, size_t size)
+{
+  if (!compiled)
+    return -1;
+  size_t len = strlen(compiled->entry.key);
+  if (size) {
+    size_t n = len < size ? len : size - 1;
+    memcpy(buf, compiled->entry.key, n);
+    buf[n] = 0;
+  }
+  return (int)len;
+}
+
+uint64_t hrs3_compiled_hash(const hrs3_compiled *compiled)
+{
+  return compiled ? compiled->entry.hash : 0;
+}
+
+const char *hrs3_compiled_kind_as_string(const hrs3_compiled *compiled)
+{
+  if (!compiled)
+    return hrs3_kind_name(Invalid);
+  const char *key = compiled->entry.key;
+  /* one that's never in is "", so go by its period */
+  if (!*key)
+    return hrs3_kind_name(compiled->entry.compiled.hrs3.kind);
+  return hrs3_kind_name(hrs3_kind(key, strlen(key)));
+}
+
+int hrs3_canonicalize(const char *hrsss, char *buf, size_t size)
+{
+  return hrs3_canonicalize_n(hrsss, hrs3_len(hrsss), buf, size);
+}
+
+int hrs3_canonicalize_n(const char *hrsss, size_t len, char *buf, size_t size)
+{
+  if (size)
+    *buf = 0;
+  if (!hrsss)
+    return -1;
+  a_compiled compiled;
+  if (OK != compiled_init(&compiled, hrsss, len))
+    return -1;
+  int n = compiled_format(&compiled, buf, size);
+  compiled_destroy(&compiled);
+  return n;
+}
+
+uint64_t hrs3_hash(const char *hrsss)
+{
+  return hrs3_hash_n(hrsss, hrs3_len(hrsss));
+}
+
+uint64_t hrs3_hash_n(const char *hrsss, size_t len)
+{
+  char buffer[256];
+  int n = hrs3_canonicalize_n(hrsss, len, buffer, sizeof(buffer));
+  if (n < 0)
+    return 0;
+  if ((size_t)n < sizeof(buffer))
+    return hash_bytes(buffer, n);
+  char *s = malloc(n + 1);
+  if (!s)
+    return 0;
+  hrs3_canonicalize_n(hrsss, len, s, n + 1);
+  uint64_t hash = hash_bytes(s, n);
+  free(s);
+  return hash;
+}
+
+hrs3_result hrs3_compiled_remaining(const hrs3_compiled *compiled, time_t time)
+{
+  if (!compiled)
+    return hrs3_result_from(remaining_invalid());
+  a_time t;
+  if (compiled->entry.tz)
+    time_init_tz(&t, time, compiled->entry.tz);
+  else
+    time_init(&t, time);
+  return hrs3_result_from(compiled_remaining(&compiled->entry.compiled, &t));
+}
+
+static bool hrs3_is_sorted(const time_t *times, size_t n)
+{
+  size_t i = 1;
+  for (; i < n; ++i)
+    if (times[i] < times[i - 1])
+      return false;
+  return true;
+}
+
+/*
+ * Ascending times are swept through a period at a time, and others
+ * are each evaluated on their own.
+ */
+void hrs3_compiled_remaining_batch(const hrs3_compiled *compiled,
+                                   const time_t *times, size_t n, hrs3_result *out)
+{
+  size_t i = 0;
+  if (!compiled) {
+    for (; i < n; ++i)
+      out[i] = hrs3_result_from(remaining_invalid());
+    return;
+  }
+  const a_tz *tz = compiled->entry.tz ? compiled->entry.tz : tz_local();
+  bool is_sorted = hrs3_is_sorted(times, n);
+  a_compiled_sweep sweep;
+  compiled_sweep_init(&sweep);
+  for (; i < n; ++i) {
+    a_time t;
+    time_init_tz(&t, times[i], tz);
+    out[i] = hrs3_result_from(is_sorted ?
+                              compiled_sweep_remaining(&compiled->entry.compiled, &sweep, &t) :
+                              compiled_remaining(&compiled->entry.compiled, &t));
+  }
+}
+
+struct hrs3_intervals {
+  a_compiled_intervals intervals;
+};
+
+static hrs3_intervals *hrs3_intervals_open_(const hrs3_compiled *compiled,
+                                            time_t begin, time_t end, bool is_in)
+{
+  if (!compiled)
+    return 0;
+  hrs3_intervals *intervals = malloc(sizeof(hrs3_intervals));
+  if (!intervals)
+    return 0;
+  compiled_intervals_init(&intervals->intervals, &compiled->entry.compiled,
+                          compiled->entry.tz ? compiled->entry.tz : tz_local(), begin, end, is_in);
+  return intervals;
+}
+
+hrs3_intervals *hrs3_intervals_open(const hrs3_compiled *compiled, time_t begin, time_t end)
+{
+  return hrs3_intervals_open_(compiled, begin, end, true);
+}
+
+hrs3_intervals *hrs3_intervals_open_out(const hrs3_compiled *compiled, time_t begin, time_t end)
+{
+  return hrs3_intervals_open_(compiled, begin, end, false);
+}
+
+int hrs3_intervals_next(hrs3_intervals *intervals, hrs3_interval *interval)
+{
+  if (!intervals)
+    return 0;
+  return compiled_intervals_next(&intervals->intervals, &interval->start, &interval->stop);
+}
+
+void hrs3_intervals_close(hrs3_intervals *intervals)
+{
+  free(intervals);
+}
+
+struct hrs3_cursor {
+  a_compiled_cursor cursor;
+};
+
+hrs3_cursor *hrs3_cursor_open(const hrs3_compiled *compiled)
+{
+  if (!compiled)
+    return 0;
+  hrs3_cursor *cursor = malloc(sizeof(hrs3_cursor));
+  if (!cursor)
+    return 0;
+  compiled_cursor_init(&cursor->cursor, &compiled->entry.compiled,
+                       compiled->entry.tz ? compiled->entry.tz : tz_local());
+  return cursor;
+}
+
+hrs3_result hrs3_cursor_remaining(hrs3_cursor *cursor, time_t time)
+{
+  if (!cursor)
+    return hrs3_result_from(remaining_invalid());
+  return hrs3_result_from(compiled_cursor_remaining(&cursor->cursor, time));
+}
+
+void hrs3_cursor_close(hrs3_cursor *cursor)
+{
+  free(cursor);
+}
+
+#define HRS3_MANY_ZONES 8
+
+/*
+ * The local time at 'time' is converted once per zone, for up to
+ * HRS3_MANY_ZONES zones, and after that each schedule is evaluated on
+ * its own.
+ */
+void hrs3_compiled_remaining_many(const hrs3_compiled *const *compiled, size_t n,
+                                  time_t time, hrs3_result *out)
+{
+  a_compiled_instant instants[HRS3_MANY_ZONES];
+  int n_instants = 0;
+  const a_tz *local = tz_local();
+  size_t i = 0;
+  for (; i < n; ++i) {
+    if (!compiled[i]) {
+      out[i] = hrs3_result_from(remaining_invalid());
+      continue;
+    }
+    const a_tz *tz = compiled[i]->entry.tz ? compiled[i]->entry.tz : local;
+    int j = 0;
+    while (j < n_instants && instants[j].t.tz != tz)
+      ++j;
+    if (j == n_instants && n_instants < HRS3_MANY_ZONES)
+      compiled_instant_init(&instants[n_instants++], time, tz);
+    if (j < n_instants) {
+      out[i] = hrs3_result_from(compiled_instant_remaining(&compiled[i]->entry.compiled,
+                                                           &instants[j]));
+    } else {
+      a_time t;
+      time_init_tz(&t, time, tz);
+      out[i] = hrs3_result_from(compiled_remaining(&compiled[i]->entry.compiled, &t));
+    }
+  }
+}
+
+long long hrs3_compiled_time_in(const hrs3_compiled *compiled, time_t begin, time_t end)
+{
+  if (!compiled)
+    return -1;
+  if (end <= begin)
+    return 0;
+  return compiled_time_in(&compiled->entry.compiled, compiled->entry.tz ? compiled->entry.tz : tz_local(),
+                          begin, end);
+}
+
+int hrs3_remaining_batch(const char *hrsss, const time_t *times, size_t n, hrs3_result *out)
+{
+  return hrs3_remaining_batch_n(hrsss, hrs3_len(hrsss), times, n, out);
+}
+
+int hrs3_remaining_batch_n(const char *hrsss, size_t len, const time_t *times, size_t n,
+                           hrs3_result *out)
+{
+  hrs3_compiled *compiled = hrs3_compile_n(hrsss, len);
+  hrs3_compiled_remaining_batch(compiled, times, n, out);
+  if (!compiled)
+    return -1;
+  hrs3_compiled_free(compiled);
+  return 0;
+}
+
+void hrs3_compiled_free(hrs3_compiled *compiled)
+{
+  if (!compiled)
+    return;
+  intern_release(&hrs3_intern, &compiled->entry);
+}
+
+void hrs3_cache_set_capacity(size_t capacity)
+{
+  cache_set_capacity(&hrs3_cache, capacity);
+}
+
+hrs3_cache_stats hrs3_cache_get_stats(void)
+{
+  hrs3_cache_stats stats;
+  MUTEX_LOCK(&hrs3_cache.mutex);
+  stats.hits = hrs3_cache.hits;
+  stats.misses = hrs3_cache.misses;
+  stats.evictions = hrs3_cache.evictions;
+  stats.size = hrs3_cache.size;
+  stats.capacity = hrs3_cache.capacity;
+  MUTEX_UNLOCK(&hrs3_cache.mutex);
+  return stats;
+}
+
+hrs3_stats hrs3_stats_get(void)
+{
+  long long counts[N_STATS];
+  stats_get(counts);
+  hrs3_stats stats;
+  stats.parses = counts[STAT_PARSES];
+  stats.mktimes = counts[STAT_MKTIMES];
+  stats.localtimes = counts[STAT_LOCALTIMES];
+  stats.grows = counts[STAT_GROWS];
+  stats.merges = counts[STAT_MERGES];
+  stats.lookaheads = counts[STAT_LOOKAHEADS];
+  return stats;
+}
+
+void hrs3_stats_reset(void)
+{
+  stats_reset();
+}
+
+void hrs3_set_allocator(const hrs3_allocator *allocator)
+{
+  a_allocator a;
+  if (allocator) {
+    a.malloc = allocator->malloc;
+    a.realloc = allocator->realloc;
+    a.free = allocator->free;
+    a.context = allocator->context;
+  }
+  arena_set_allocator(allocator ? &a : 0);
+}
+
+void hrs3_set_scratch(void *buffer, size_t size)
+{
+  arena_set_scratch(buffer, size);
+}
+
 #if RUN_TESTS
 
 int test_hrs3_remaining_in(void)
@@ -125,10 +649,563 @@ int test_hrs3_remaining_out(void)
   return OK;
 }
 
+int test_hrs3_compiled_remaining(void)
+{
+  struct tm ymdhms;
+  time_t t = time(0);
+  LOCALTIME_R(&t, &ymdhms);
+#define X(IS_IN, SECS, x, h, m, s)                             \
+  do {                                                         \
+    ymdhms.tm_hour = h;                                        \
+    ymdhms.tm_min = m;                                         \
+    ymdhms.tm_sec = s;                                         \
+    t = mktime(&ymdhms);                                       \
+    hrs3_compiled *compiled = hrs3_compile(x);                 \
+    if (!compiled) TFAIL();                                    \
+    hrs3_result result = hrs3_compiled_remaining(compiled, t); \
+    if (!result.is_valid) TFAIL();                             \
+    if (IS_IN != result.is_in) TFAIL();                        \
+    if (SECS != result.seconds)                                \
+      TFAILF(" %d vs %d", SECS, result.seconds);               \
+    hrs3_compiled_free(compiled);                              \
+  } while_0
+  X(0,         1, "9-10",  8, 59, 59);
+  X(1,      3600, "9-10",  9,  0,  0);
+  X(1,      3599, "9-10",  9,  0,  1);
+  X(1,         1, "9-10",  9, 59, 59);
+  X(0, 3600 * 23, "9-10", 10,  0,  0);
+  X(0, 3600 * 23, "9:00-10:00", 10,  0,  0);
+#undef X
+  if (hrs3_compile("abc")) TFAIL();
+  if (hrs3_compile(0)) TFAIL();
+  if (hrs3_compiled_remaining(0, t).is_valid) TFAIL();
+  return OK;
+}
+
+int test_hrs3_cache(void)
+{
+  hrs3_cache_set_capacity(4);
+  hrs3_cache_stats before = hrs3_cache_get_stats();
+  test_hrs3_remaining_in();
+  test_hrs3_remaining_out();
+  if (strcmp("daily", hrs3_kind_as_string("9:00-10:00"))) TFAIL();
+  hrs3_cache_stats after = hrs3_cache_get_stats();
+  if (4 != after.capacity) TFAIL();
+  if (after.size < 2) TFAIL(); /* 9-10 and 900-1000, and invalid ones */
+  if (after.hits - before.hits < 8) TFAIL();
+  /* bad input is a hit the second time, and isn't parsed again */
+  time_t t = time(0);
+  hrs3_remaining_in("8-25", t);
+  before = hrs3_cache_get_stats();
+  unsigned long long parses = hrs3_stats_get().parses;
+  if (-1 != hrs3_remaining_in("8-25", t)) TFAIL();
+  if (strcmp("daily", hrs3_kind_as_string("8-25"))) TFAIL();
+  after = hrs3_cache_get_stats();
+  if (2 != after.hits - before.hits || after.misses != before.misses) TFAIL();
+  if (parses != hrs3_stats_get().parses) TFAIL();
+  hrs3_cache_set_capacity(0);
+  if (hrs3_cache_get_stats().size) TFAIL();
+  return OK;
+}
+
+/* Cached schedules give the same results as parsing, across DST changes too. */
+int test_hrs3_cache_dst(void)
+{
+  static const char *hrsss[] = {
+    "1-3", "130-230", "0-1&23-24", "U1-2&3-4.M6-7&8-9", "A23-24.U0-1", "B2015U1-3|A2-3",
+  };
+  static const char *zones[] = { "America/Los_Angeles", "Europe/Berlin" };
+  /* the US and European changes of 2015 */
+  static const time_t changes[] = { 1425808800, 1427590800, 1445734800, 1446368400 };
+  enum { N = 2 * 24 * 6 };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    size_t j = 0;
+    for (; j < DIM(zones) * DIM(changes); ++j) {
+      const char *zone = zones[j / DIM(changes)];
+      time_t begin = changes[j % DIM(changes)] - 3600 * 24;
+      int in[N], out[N];
+      int k = 0;
+      hrs3_cache_set_capacity(0);
+      for (; k < N; ++k) {
+        in[k] = hrs3_remaining_in_tz(hrsss[i], zone, begin + 599 * k);
+        out[k] = hrs3_remaining_out_tz(hrsss[i], zone, begin + 599 * k);
+      }
+      hrs3_cache_set_capacity(4);
+      for (k = 0; k < N; ++k) {
+        time_t t = begin + 599 * k;
+        if (in[k] != hrs3_remaining_in_tz(hrsss[i], zone, t) ||
+            out[k] != hrs3_remaining_out_tz(hrsss[i], zone, t))
+          TFAILF(" %s in %s at %ld", hrsss[i], zone, (long)t);
+      }
+    }
+  }
+  hrs3_cache_set_capacity(0);
+  return OK;
+}
+
+/* Slices of a buffer, which go on past len and have colons. */
+int test_hrs3_n(void)
+{
+  static const char buf[] = "9:00-17:30&18-19 now+5m 20150429120000-20150429120001XY";
+  const char *daily = buf, *now = buf + 17, *raw = buf + 24;
+  time_t t = time(0);
+  if (hrs3_remaining_in_n(daily, 10, t) != hrs3_remaining_in("900-1730", t)) TFAIL();
+  if (hrs3_remaining_out_n(daily, 10, t) != hrs3_remaining_out("900-1730", t)) TFAIL();
+  if (hrs3_remaining_in_n(daily, 16, t) != hrs3_remaining_in("900-1730&18-19", t)) TFAIL();
+  if (-1 != hrs3_remaining_in_n(daily, 3, t)) TFAIL();
+  if (-1 != hrs3_remaining_in_n(now, 5, t)) TFAIL(); /* "now+5" has no unit */
+  if (hrs3_remaining_out_n(now, 6, t)) TFAIL();
+  if (-1 != hrs3_remaining_in_n(raw, 31, t)) TFAIL();
+  if (strcmp("daily", hrs3_kind_as_string_n(daily, 10))) TFAIL();
+  if (strcmp("invalid", hrs3_kind_as_string_n(now, 2))) TFAIL();
+  if (strcmp("raw", hrs3_kind_as_string_n(raw, 29))) TFAIL();
+  char canonical[32];
+  if (6 != hrs3_canonicalize_n(daily, 10, canonical, sizeof(canonical))) TFAIL();
+  if (strcmp("9-1730", canonical)) TFAILF(" %s", canonical);
+  if (hrs3_hash_n(daily, 10) != hrs3_hash("9-1730")) TFAIL();
+  if (0 != hrs3_hash_n(daily, 2)) TFAIL();
+  hrs3_compiled *compiled = hrs3_compile_n(daily, 10);
+  hrs3_compiled *same = hrs3_compile("9-1730");
+  if (!compiled || compiled != same) TFAIL();
+  hrs3_compiled_free(compiled);
+  hrs3_compiled_free(same);
+  if (hrs3_compile_n(now, 5) || hrs3_compile_tz_n(raw, 30, "UTC")) TFAIL();
+  hrs3_result results[2];
+  time_t times[2] = { t, t + 3600 };
+  if (0 != hrs3_remaining_batch_n(raw, 29, times, 2, results)) TFAIL();
+  if (!results[1].is_valid) TFAIL();
+
+  /* cached by the string without its colons */
+  hrs3_cache_set_capacity(4);
+  hrs3_remaining_in_n(daily, 10, t);
+  hrs3_cache_stats before = hrs3_cache_get_stats();
+  if (hrs3_remaining_in_n(daily, 10, t) != hrs3_remaining_in("900-1730", t)) TFAIL();
+  hrs3_cache_stats after = hrs3_cache_get_stats();
+  if (1 != after.size || 2 != after.hits - before.hits) TFAIL();
+  hrs3_cache_set_capacity(0);
+  return OK;
+}
+
+int test_hrs3_stats(void)
+{
+  struct tm ymdhms;
+  time_t t = time(0);
+  LOCALTIME_R(&t, &ymdhms);
+  ymdhms.tm_mday += 3 - ymdhms.tm_wday; /* Wednesday */
+  ymdhms.tm_hour = 14;
+  ymdhms.tm_min = ymdhms.tm_sec = 0;
+  ymdhms.tm_isdst = -1;
+  t = mktime(&ymdhms);
+  hrs3_stats_reset();
+  /* shifts that abut at midnight, and are over for the week */
+  if (0 == hrs3_remaining_out("U23-24.M0-1", t)) TFAIL();
+  hrs3_stats stats = hrs3_stats_get();
+#if STATS
+  if (1 != stats.parses) TFAILF(" %llu", stats.parses);
+  if (!stats.mktimes || !stats.localtimes || !stats.grows) TFAIL();
+  if (!stats.merges || !stats.lookaheads) TFAIL();
+#endif
+  hrs3_compiled *compiled = hrs3_compile("9-17");
+  hrs3_stats_reset();
+  hrs3_compiled_remaining(compiled, t);
+  stats = hrs3_stats_get();
+  if (stats.parses || stats.grows || stats.merges || stats.lookaheads) TFAIL();
+  hrs3_compiled_free(compiled);
+  return OK;
+}
+
+static int test_hrs3_n_mallocs;
+
+static void *test_hrs3_malloc(void *context, size_t size)
+{
+  (void)context;
+  ++test_hrs3_n_mallocs;
+  return malloc(size);
+}
+
+static void *test_hrs3_realloc(void *context, void *p, size_t size)
+{
+  (void)context;
+  ++test_hrs3_n_mallocs;
+  return realloc(p, size);
+}
+
+static void test_hrs3_free(void *context, void *p)
+{
+  (void)context;
+  free(p);
+}
+
+static void *test_hrs3_no_malloc(void *context, size_t size)
+{
+  (void)context;
+  (void)size;
+  return 0;
+}
+
+static void *test_hrs3_no_realloc(void *context, void *p, size_t size)
+{
+  (void)context;
+  (void)p;
+  (void)size;
+  return 0;
+}
+
+/* Once the arena fits, or with a scratch buffer, evaluating allocates nothing. */
+int test_hrs3_allocator(void)
+{
+  hrs3_allocator counting = { test_hrs3_malloc, test_hrs3_realloc, test_hrs3_free, 0 };
+  hrs3_set_allocator(&counting);
+  time_t t = time(0);
+  static const char *hrssss[] = {
+    "9-17", "MWF10-12&13-17.T8-9", "B2015M8-12|T8-12", "now+1h",
+    "20150609120000-20150609130000"
+  };
+  size_t i = 0;
+  for (; i < DIM(hrssss); ++i) {
+    hrs3_remaining_in(hrssss[i], t);
+    test_hrs3_n_mallocs = 0;
+    hrs3_remaining_in(hrssss[i], t + 3600);
+    hrs3_remaining_out(hrssss[i], t + 7200);
+    if (test_hrs3_n_mallocs) TFAILF(" %s: %d", hrssss[i], test_hrs3_n_mallocs);
+  }
+  char scratch[1024];
+  hrs3_set_scratch(scratch, sizeof(scratch));
+  test_hrs3_n_mallocs = 0;
+  if (!hrs3_remaining_in("0-24", t)) TFAIL();
+  if (test_hrs3_n_mallocs) TFAIL();
+  /* what doesn't fit in the scratch buffer, and can't be allocated, fails */
+  hrs3_allocator none = { test_hrs3_no_malloc, test_hrs3_no_realloc, test_hrs3_free, 0 };
+  hrs3_set_allocator(&none);
+  hrs3_set_scratch(scratch, 64);
+  if (-1 != hrs3_remaining_in("MWF10-12&13-17.T8-9", t)) TFAIL();
+  if (-1 != hrs3_remaining_out("20150609120000-20150609130000", t)) TFAIL();
+  hrs3_set_scratch(0, 0);
+  hrs3_set_allocator(0);
+  return OK;
+}
+
+/* 1445000000 is 2015-10-16 12:53:20 UTC */
+int test_hrs3_remaining_tz(void)
+{
+  if (!tz_get("America/Chicago") || !tz_get("Asia/Tokyo"))
+    return OK; /* no zoneinfo */
+#define X(ZONE, x, IN, OUT) do {                                        \
+    if (IN != hrs3_remaining_in_tz(x, ZONE, 1445000000)) TFAIL();       \
+    if (OUT != hrs3_remaining_out_tz(x, ZONE, 1445000000)) TFAIL();     \
+    hrs3_compiled *compiled = hrs3_compile_tz(x, ZONE);                 \
+    hrs3_result result = hrs3_compiled_remaining(compiled, 1445000000); \
+    if (IN != (result.is_in ? result.seconds : 0)) TFAIL();             \
+    if (OUT != (result.is_in ? 0 : result.seconds)) TFAIL();            \
+    hrs3_compiled_free(compiled);                                       \
+  } while_0
+  X("America/Chicago", "9-17",         0,  4000);
+  X("Asia/Tokyo",      "9-17",         0, 40000);
+  X("UTC",             "9-17",     14800,     0);
+  X("America/Chicago", "F8-9",         0,   400);
+  X("Asia/Tokyo",      "UMTWRFA21-22", 400,  0);
+  X("America/Chicago", "20151016090000-20151016100000", 0, 4000);
+  X("Asia/Tokyo",      "20151016090000-20151016100000", 0,    0);
+#undef X
+  if (-1 != hrs3_remaining_in_tz("9-17", "Not/AZone", 1445000000)) TFAIL();
+  if (hrs3_compile_tz("9-17", "Not/AZone")) TFAIL();
+  if (-1 != hrs3_remaining_in_tz("9-17", "/usr/share/zoneinfo/UTC", 1445000000)) TFAIL();
+  if (hrs3_remaining_in("9-17", 1445000000) !=
+      hrs3_remaining_in_tz("9-17", 0, 1445000000)) TFAIL();
+
+  /* raw times compiled in one zone aren't reused for another */
+  hrs3_cache_set_capacity(4);
+  if (4000 != hrs3_remaining_out_tz("20151016090000-20151016100000",
+                                    "America/Chicago", 1445000000)) TFAIL();
+  if (0 != hrs3_remaining_out_tz("20151016090000-20151016100000",
+                                 "Asia/Tokyo", 1445000000)) TFAIL();
+  if (40000 != hrs3_remaining_out_tz("9-17", "Asia/Tokyo", 1445000000)) TFAIL();
+  if (4000 != hrs3_remaining_out_tz("9-17", "America/Chicago", 1445000000)) TFAIL();
+  hrs3_cache_set_capacity(0);
+  return OK;
+}
+
+int test_hrs3_remaining_batch(void)
+{
+  const char *hrsss[] = { "MWF10-12&13-17", "830-12", "U23-24.M0-1", "now+1h", "abc" };
+  time_t times[2000];
+  hrs3_result results[DIM(times)];
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    size_t j = 0;
+    for (; j < DIM(times); ++j)
+      times[j] = 1445000000 + 997 * (time_t)j;
+    times[DIM(times) - 1] = times[0];
+    size_t n = DIM(times) - 1; /* sorted, then unsorted */
+    for (; n <= DIM(times); ++n) {
+      int ret = hrs3_remaining_batch(hrsss[i], times, n, results);
+      if ((strcmp(hrsss[i], "abc") ? 0 : -1) != ret) TFAIL();
+      for (j = 0; j < n; ++j) {
+        int in = hrs3_remaining_in(hrsss[i], times[j]);
+        int out = hrs3_remaining_out(hrsss[i], times[j]);
+        hrs3_result *r = &results[j];
+        if (r->is_valid != (-1 != in)) TFAIL();
+        if (r->is_valid && (r->is_in ? in : out) != r->seconds)
+          TFAILF(" %s at %ld: %d %d vs %d %d", hrsss[i], (long)times[j],
+                 in, out, r->is_in, r->seconds);
+      }
+    }
+  }
+  return OK;
+}
+
+int test_hrs3_compiled_remaining_many(void)
+{
+  const char *hrsss[] = { "MWF10-12&13-17", "830-12", "U23-24.M0-1", "now+1h", "abc",
+                          "20151016090000-20151016100000" };
+  const char *zones[] = { 0, "America/Chicago", "Asia/Tokyo" };
+  hrs3_compiled *compiled[DIM(hrsss) * DIM(zones)];
+  hrs3_result results[DIM(compiled)];
+  size_t i = 0;
+  for (; i < DIM(compiled); ++i)
+    compiled[i] = hrs3_compile_tz(hrsss[i % DIM(hrsss)], zones[i / DIM(hrsss)]);
+  time_t t = 1445000000;
+  for (; t < 1445000000 + 14 * 24 * 3600; t += 3 * 3607) {
+    hrs3_compiled_remaining_many((const hrs3_compiled *const *)compiled, DIM(compiled),
+                                 t, results);
+    for (i = 0; i < DIM(compiled); ++i) {
+      hrs3_result expected = hrs3_compiled_remaining(compiled[i], t);
+      if (expected.is_valid != results[i].is_valid ||
+          expected.is_in != results[i].is_in ||
+          expected.seconds != results[i].seconds)
+        TFAILF(" %s at %ld", hrsss[i % DIM(hrsss)], (long)t);
+    }
+  }
+  for (i = 0; i < DIM(compiled); ++i)
+    hrs3_compiled_free(compiled[i]);
+  return OK;
+}
+
+int test_hrs3_cursor(void)
+{
+  const char *hrsss[] = { "MWF10-12&13-17", "0-1&23-24", "A22-24.U0-2", "now+2h", "abc" };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    hrs3_compiled *compiled = hrs3_compile(hrsss[i]);
+    hrs3_cursor *cursor = hrs3_cursor_open(compiled);
+    /* a second at a time for a day, then back a week, then a year on */
+    time_t t = 1445000000;
+    int k = 0;
+    for (; k < 24 * 3600 + 2; ++k) {
+      t = k < 24 * 3600 ? t + 1 : k == 24 * 3600 ? t - 7 * 24 * 3600 : t + 365 * 24 * 3600;
+      hrs3_result expected = hrs3_compiled_remaining(compiled, t);
+      hrs3_result result = hrs3_cursor_remaining(cursor, t);
+      if (expected.is_valid != result.is_valid ||
+          expected.is_in != result.is_in ||
+          expected.seconds != result.seconds)
+        TFAILF(" %s at %ld", hrsss[i], (long)t);
+    }
+    hrs3_cursor_close(cursor);
+    hrs3_compiled_free(compiled);
+  }
+  return OK;
+}
+
+int test_hrs3_intervals(void)
+{
+  /* 1445000000 is a Friday, compare with stepping like Hrs3::aggTime */
+  const char *hrsss[] = { "MWF10-12&13-17", "0-1&23-24", "A22-24.U0-2", "abc" };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    hrs3_compiled *compiled = hrs3_compile(hrsss[i]);
+    hrs3_intervals *intervals = hrs3_intervals_open(compiled, 1445000000, 1446000000);
+    hrs3_interval interval = { 0, 0 };
+    bool has_next = hrs3_intervals_next(intervals, &interval) ? true : false;
+    time_t t = 1445000000;
+    while (t < 1446000000) {
+      int in = hrs3_remaining_in(hrsss[i], t);
+      int out = hrs3_remaining_out(hrsss[i], t);
+      if (in < 0) {
+        if (has_next) TFAIL();
+        break;
+      }
+      time_t stop = t + (in ? in : out ? out : 1446000000 - t);
+      if (1446000000 < stop)
+        stop = 1446000000;
+      if (in && !has_next) TFAILF(" %s at %ld", hrsss[i], (long)t);
+      if (in && interval.start <= t && t < interval.stop) {
+        if (stop == interval.stop)
+          has_next = hrs3_intervals_next(intervals, &interval) ? true : false;
+        else if (interval.stop < stop)
+          TFAILF(" %s at %ld", hrsss[i], (long)t);
+      } else if (in || (has_next && interval.start < stop)) {
+        TFAILF(" %s at %ld: %ld-%ld", hrsss[i], (long)t,
+               (long)interval.start, (long)interval.stop);
+      }
+      t = stop;
+    }
+    if (has_next) TFAIL();
+    hrs3_intervals_close(intervals);
+    hrs3_compiled_free(compiled);
+  }
+  return OK;
+}
+
+int test_hrs3_compiled_time_in(void)
+{
+  /* compare with stepping like Hrs3::aggTime used to, across the end of DST */
+  const char *hrsss[] = { "MWF10-12&13-17", "0-1&23-24", "A22-24.U0-2", "UMTWRFA0-24",
+                          "B2015MW8-12|T8-12", "P9-17", "20151016090000-20151016100000", "abc" };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    hrs3_compiled *compiled = hrs3_compile(hrsss[i]);
+    time_t begin = 1445000000 + 1234 * (time_t)i;
+    time_t end = begin + 5 * 7 * 24 * 3600 + 3333;
+    long long in = 0;
+    time_t t = begin;
+    while (t < end) {
+      int seconds = hrs3_remaining_in(hrsss[i], t);
+      if (seconds < 0) {
+        in = -1;
+        break;
+      }
+      if (!seconds) {
+        seconds = hrs3_remaining_out(hrsss[i], t);
+        if (!seconds || end - t < seconds)
+          seconds = (int)(end - t);
+      } else {
+        if (end - t < seconds)
+          seconds = (int)(end - t);
+        in += seconds;
+      }
+      t += seconds;
+    }
+    if (in != hrs3_compiled_time_in(compiled, begin, end))
+      TFAILF(" %s %lld", hrsss[i], hrs3_compiled_time_in(compiled, begin, end));
+    if (compiled && 0 != hrs3_compiled_time_in(compiled, end, begin)) TFAIL();
+    hrs3_compiled_free(compiled);
+  }
+  /* a now schedule starts at the beginning of the window */
+  hrs3_compiled *compiled = hrs3_compile("now+1h");
+  if (3600 != hrs3_compiled_time_in(compiled, 1445000000, 1446000000)) TFAIL();
+  hrs3_compiled_free(compiled);
+  if (-1 != hrs3_compiled_time_in(0, 1445000000, 1446000000)) TFAIL();
+  return OK;
+}
+
+int test_hrs3_compiled_combine(void)
+{
+  /* 1445021600 is Friday 2015-10-16 at 13:53:20 in Chicago */
+  hrs3_compiled *business = hrs3_compile_tz("MTWRF9-17", "America/Chicago");
+  hrs3_compiled *maintenance = hrs3_compile_tz("F13-15", "America/Chicago");
+  hrs3_compiled *policy = hrs3_compiled_difference(business, maintenance);
+  hrs3_result result = hrs3_compiled_remaining(policy, 1445021600);
+  if (!result.is_valid || result.is_in || 3600 + 400 != result.seconds) TFAIL();
+  hrs3_compiled *either = hrs3_compiled_union(business, maintenance);
+  result = hrs3_compiled_remaining(either, 1445021600);
+  if (!result.is_valid || !result.is_in || 3 * 3600 + 400 != result.seconds) TFAIL();
+  hrs3_compiled *both = hrs3_compiled_intersection(business, maintenance);
+  hrs3_compiled *not_both = hrs3_compiled_complement(both);
+  char buf[64];
+  if (22 != hrs3_compiled_format(not_both, buf, sizeof(buf))) TFAILF(" %s", buf);
+  if (strcmp("MTWRAU0-24.F0-13&15-24", buf)) TFAILF(" %s", buf);
+  hrs3_compiled *local = hrs3_compile("F13-15");
+  if (hrs3_compiled_union(business, local)) TFAIL();
+  if (hrs3_compiled_complement(0)) TFAIL();
+  if (-1 != hrs3_compiled_format(0, buf, sizeof(buf))) TFAIL();
+  hrs3_compiled_free(local);
+  hrs3_compiled_free(not_both);
+  hrs3_compiled_free(both);
+  hrs3_compiled_free(either);
+  hrs3_compiled_free(policy);
+  hrs3_compiled_free(maintenance);
+  hrs3_compiled_free(business);
+  return OK;
+}
+
+int test_hrs3_canonicalize(void)
+{
+  char buf[32];
+#define X(S, EXPECTED) do {                                                     \
+    if ((int)strlen(EXPECTED) != hrs3_canonicalize(S, buf, sizeof(buf)))        \
+      TFAILF(" %s", buf);                                                       \
+    if (strcmp(EXPECTED, buf)) TFAILF(" %s", buf);                              \
+    if (hrs3_hash(S) != hrs3_hash(EXPECTED)) TFAIL();                           \
+  } while_0
+  X("MWF10-12.M13-15", "M10-12&13-15.WF10-12");
+  X("10:00-12:00", "10-12");
+  X("now+60m", "now+1h");
+  X("B2015T8-9.M8-9|W8-9", "B2015MT8-9|W8-9");
+  X("BMWF10-12|MWF10-12", "MWF10-12");
+  X("MTWRF9-17", "P9-17");
+#undef X
+  if (-1 != hrs3_canonicalize("abc", buf, sizeof(buf)) || *buf) TFAIL();
+  if (0 != hrs3_hash("abc")) TFAIL();
+  if (hrs3_hash("8-9") == hrs3_hash("8-10")) TFAIL();
+  if (0xe8dd67b3d402fbe2ULL != hrs3_hash("M10-12&13-15.WF10-12"))
+    TFAILF(" %llx", (unsigned long long)hrs3_hash("M10-12&13-15.WF10-12"));
+  /* longer than hrs3_hash's buffer */
+  char long_hrsss[1024];
+  size_t len = 0;
+  int hour = 0;
+  for (; hour < 24; ++hour)
+    len += sprintf(&long_hrsss[len], "%s%d-%d30", hour ? "&" : "M", hour, hour);
+  for (hour = 0; hour < 24; ++hour)
+    len += sprintf(&long_hrsss[len], "%s%d30-%d", hour ? "&" : ".TWRFAU", hour, hour + 1);
+  if (hrs3_canonicalize(long_hrsss, 0, 0) < 256) TFAIL();
+  if (!hrs3_hash(long_hrsss) || hrs3_hash(long_hrsss) == hrs3_hash("8-9")) TFAIL();
+  return OK;
+}
+
+int test_hrs3_intern(void)
+{
+  size_t size = hrs3_intern.size;
+  hrs3_compiled *a = hrs3_compile("MWF10-12.M13-15");
+  hrs3_compiled *b = hrs3_compile("M10-12&13-15.WF10-12");
+  hrs3_compiled *c = hrs3_compile("M10:00-12:00&13-15.WF10-12");
+  hrs3_compiled *chicago = hrs3_compile_tz("M10-12&13-15.WF10-12", "America/Chicago");
+  if (!a || a != b || a != c || a == chicago) TFAIL();
+  if (size + 2 != hrs3_intern.size) TFAIL();
+  if (hrs3_compiled_hash(a) != hrs3_hash("MWF10-12.M13-15")) TFAIL();
+  hrs3_compiled *m = hrs3_compile("M10-12&13-15");
+  hrs3_compiled *wf = hrs3_compile("WF10-12");
+  hrs3_compiled *either = hrs3_compiled_union(m, wf);
+  if (either != a) TFAIL();
+  hrs3_compiled_free(either);
+  hrs3_compiled_free(wf);
+  hrs3_compiled_free(m);
+  hrs3_compiled_free(a);
+  hrs3_compiled_free(b);
+  if (size + 2 != hrs3_intern.size) TFAIL();
+  hrs3_result result = hrs3_compiled_remaining(c, 1445000000);
+  if (!result.is_valid) TFAIL();
+  hrs3_compiled_free(c);
+  hrs3_compiled_free(chicago);
+  if (size != hrs3_intern.size) TFAIL();
+  /* a schedule that's never in is keyed "", which doesn't compile */
+  hrs3_compiled *eight = hrs3_compile("8-9");
+  hrs3_compiled *never = hrs3_compiled_difference(eight, eight);
+  if (!never || hrs3_compile("") || hrs3_compile_n("8-9", 0)) TFAIL();
+  hrs3_compiled_free(never);
+  hrs3_compiled_free(eight);
+  return OK;
+}
+
 PRE_INIT(test_hrs3)
 {
   test_hrs3_remaining_in();
   test_hrs3_remaining_out();
+  test_hrs3_compiled_remaining();
+  test_hrs3_cache();
+  test_hrs3_cache_dst();
+  test_hrs3_n();
+  test_hrs3_stats();
+  test_hrs3_allocator();
+  test_hrs3_remaining_tz();
+  test_hrs3_remaining_batch();
+  test_hrs3_compiled_remaining_many();
+  test_hrs3_intervals();
+  test_hrs3_cursor();
+  test_hrs3_compiled_time_in();
+  test_hrs3_compiled_combine();
+  test_hrs3_canonicalize();
+  test_hrs3_intern();
 }
 #endif /* RUN_TESTS */
 
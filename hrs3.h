@@ -1,9 +1,68 @@
 #ifndef __hrs3_h__
 #define __hrs3_h__
 
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 #include "extern_c.h"
 
+/*
+ * The result of evaluating a time against a schedule.  If is_in, then
+ * time through time + seconds falls within the schedule.  Otherwise,
+ * time + seconds is when the next scheduled period starts, or seconds
+ * is 0 if there is no next period.
+ */
+typedef struct hrs3_result {
+  int is_valid;
+  int is_in;
+  int seconds;
+} hrs3_result;
+
+/*
+ * A parsed schedule that can be evaluated many times.  Compiled
+ * schedules are immutable and shared: compiling a schedule that means
+ * the same as one that is already compiled in the same zone, such as
+ * "MWF10-12.M13-15" and "M10-12&13-15.WF10-12", returns the same
+ * object with another reference, which hrs3_compiled_free releases.
+ */
+typedef struct hrs3_compiled hrs3_compiled;
+
+/* The times from start through stop - 1. */
+typedef struct hrs3_interval {
+  time_t start;
+  time_t stop;
+} hrs3_interval;
+
+typedef struct hrs3_intervals hrs3_intervals;
+
+typedef struct hrs3_cursor hrs3_cursor;
+
+typedef struct hrs3_cache_stats {
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+  size_t size;
+  size_t capacity;
+} hrs3_cache_stats;
+
+/* Counts of the costly steps of evaluating schedules. */
+typedef struct hrs3_stats {
+  unsigned long long parses;     /* hrs3 strings parsed */
+  unsigned long long mktimes;    /* local times turned into times, as by mktime */
+  unsigned long long localtimes; /* times turned into local times, as by localtime_r */
+  unsigned long long grows;      /* schedules grown */
+  unsigned long long merges;     /* shifts merged with overlapping ones */
+  unsigned long long lookaheads; /* days or weeks hrs3_remaining_in and _out looked ahead */
+} hrs3_stats;
+
+/* Where hrs3 gets memory from; context is passed to each function. */
+typedef struct hrs3_allocator {
+  void *(*malloc)(void *context, size_t size);
+  void *(*realloc)(void *context, void *p, size_t size);
+  void (*free)(void *context, void *p);
+  void *context;
+} hrs3_allocator;
+
 EXTERN_C
 int hrs3_remaining_in(const char *s, time_t time);
 EXTERN_C
@@ -11,4 +70,228 @@ int hrs3_remaining_out(const char *s, time_t time);
 EXTERN_C
 const char *hrs3_kind_as_string(const char *s);
 
+EXTERN_C
+hrs3_compiled *hrs3_compile(const char *s);
+EXTERN_C
+hrs3_result hrs3_compiled_remaining(const hrs3_compiled *compiled, time_t time);
+EXTERN_C
+void hrs3_compiled_free(hrs3_compiled *compiled);
+
+/*
+ * Combine compiled daily, weekly or biweekly schedules into a new
+ * compiled schedule, e.g., business hours minus a maintenance window,
+ * which costs the same to evaluate as any single schedule.  Shifts
+ * that overlap or abut are merged, so the seconds remaining run
+ * through the seams.  These return null if an operand is null, is a
+ * raw or now schedule, or is in a different zone than the other.
+ */
+EXTERN_C
+hrs3_compiled *hrs3_compiled_union(const hrs3_compiled *a, const hrs3_compiled *b);
+EXTERN_C
+hrs3_compiled *hrs3_compiled_intersection(const hrs3_compiled *a, const hrs3_compiled *b);
+EXTERN_C
+hrs3_compiled *hrs3_compiled_difference(const hrs3_compiled *a, const hrs3_compiled *b);
+EXTERN_C
+hrs3_compiled *hrs3_compiled_complement(const hrs3_compiled *a);
+
+/*
+ * Write a compiled schedule, such as a combination, as its canonical
+ * hrs3 string, like snprintf, without formatting it anew.  Return the
+ * length of the string, 0 if the schedule is never in, or -1 if
+ * compiled is null.
+ */
+EXTERN_C
+int hrs3_compiled_format(const hrs3_compiled *compiled, char *buf, size_t size);
+
+/*
+ * The kind of a compiled schedule, as hrs3_kind_as_string gives it for
+ * its canonical form.  One that is never in is of the kind its period
+ * is, such as "daily".  "invalid" if compiled is null.
+ */
+EXTERN_C
+const char *hrs3_compiled_kind_as_string(const hrs3_compiled *compiled);
+
+/*
+ * Write the canonical form of s (see README.md), like snprintf, so
+ * that "MWF10-12.M13-15" and "M10-12&13-15.WF10-12" are the same
+ * string.  Return its length, or -1 if s is invalid.  hrs3_hash is a
+ * 64-bit FNV-1a hash of the canonical form, which is the same on
+ * every platform, or 0 if s is invalid.  hrs3_compiled_hash is the
+ * same hash of a compiled schedule, without parsing anything.
+ */
+EXTERN_C
+int hrs3_canonicalize(const char *s, char *buf, size_t size);
+EXTERN_C
+uint64_t hrs3_hash(const char *s);
+EXTERN_C
+uint64_t hrs3_compiled_hash(const hrs3_compiled *compiled);
+
+/*
+ * Iterate over the intervals of a compiled schedule that fall within
+ * begin through end - 1, clipped to that window.  Intervals that
+ * continue across midnight or the end of a week are merged into one.
+ * hrs3_intervals_open_out iterates over the intervals outside of the
+ * schedule instead.  hrs3_intervals_next returns 0 when there are no
+ * more.  The compiled schedule must outlive the iterator.
+ *
+ *   hrs3_intervals *intervals = hrs3_intervals_open(compiled, begin, end);
+ *   hrs3_interval interval;
+ *   while (hrs3_intervals_next(intervals, &interval))
+ *     ...
+ *   hrs3_intervals_close(intervals);
+ */
+EXTERN_C
+hrs3_intervals *hrs3_intervals_open(const hrs3_compiled *compiled, time_t begin, time_t end);
+EXTERN_C
+hrs3_intervals *hrs3_intervals_open_out(const hrs3_compiled *compiled, time_t begin, time_t end);
+EXTERN_C
+int hrs3_intervals_next(hrs3_intervals *intervals, hrs3_interval *interval);
+EXTERN_C
+void hrs3_intervals_close(hrs3_intervals *intervals);
+
+/*
+ * Evaluate a compiled schedule at times that mostly move forward, such
+ * as a loop that asks every second.  The cursor remembers the interval
+ * the last time fell in, so until it ends, hrs3_cursor_remaining is a
+ * comparison, and after it, the cursor moves on through the schedule
+ * from there.  Times that go backwards or jump far ahead are looked up
+ * afresh.  The compiled schedule must outlive the cursor, and a cursor
+ * is for one thread at a time.
+ *
+ *   hrs3_cursor *cursor = hrs3_cursor_open(compiled);
+ *   for (;;) {
+ *     hrs3_result result = hrs3_cursor_remaining(cursor, time(0));
+ *     ...
+ *   }
+ *   hrs3_cursor_close(cursor);
+ */
+EXTERN_C
+hrs3_cursor *hrs3_cursor_open(const hrs3_compiled *compiled);
+EXTERN_C
+hrs3_result hrs3_cursor_remaining(hrs3_cursor *cursor, time_t time);
+EXTERN_C
+void hrs3_cursor_close(hrs3_cursor *cursor);
+
+/*
+ * Evaluate many compiled schedules at one time, setting out[i] for
+ * compiled[i].  The calendar work for 'time' is done once rather than
+ * once per schedule.
+ */
+EXTERN_C
+void hrs3_compiled_remaining_many(const hrs3_compiled *const *compiled, size_t n,
+                                  time_t time, hrs3_result *out);
+
+/*
+ * The number of seconds from begin through end - 1 that are in the
+ * schedule, or -1 if compiled is null.  Whole weeks (or days) are
+ * counted at once, so this is fast even for a window of decades.
+ */
+EXTERN_C
+long long hrs3_compiled_time_in(const hrs3_compiled *compiled, time_t begin, time_t end);
+
+/*
+ * Evaluate one schedule at each of times[0] through times[n - 1],
+ * setting out[0] through out[n - 1].  This is fastest when times are
+ * ascending.  hrs3_remaining_batch returns -1 if s is not a valid
+ * hrs3, and then every result is invalid.
+ */
+EXTERN_C
+int hrs3_remaining_batch(const char *s, const time_t *times, size_t n, hrs3_result *out);
+EXTERN_C
+void hrs3_compiled_remaining_batch(const hrs3_compiled *compiled,
+                                   const time_t *times, size_t n, hrs3_result *out);
+
+/*
+ * These evaluate in the zone named by 'zone', such as
+ * "America/Chicago", instead of the zone of TZ, so one process can
+ * answer for many zones from many threads at once.  Zones are loaded
+ * from the system's zoneinfo on first use and shared.  A zone is a
+ * name in the zoneinfo directory, not a path or a POSIX TZ string.  A
+ * null zone means the zone of TZ.  An unknown zone fails like an
+ * invalid schedule, as does any zone on Windows.
+ */
+EXTERN_C
+int hrs3_remaining_in_tz(const char *s, const char *zone, time_t time);
+EXTERN_C
+int hrs3_remaining_out_tz(const char *s, const char *zone, time_t time);
+EXTERN_C
+hrs3_compiled *hrs3_compile_tz(const char *s, const char *zone);
+
+/*
+ * Each function that takes a NUL-terminated schedule has an _n
+ * variant that takes the len characters at s instead, such as a
+ * slice of a larger buffer, which needn't be NUL-terminated.  They
+ * read only those characters and don't copy them.  As everywhere,
+ * times may be written with colons, as in "9:00-17:30".
+ */
+EXTERN_C
+int hrs3_remaining_in_n(const char *s, size_t len, time_t time);
+EXTERN_C
+int hrs3_remaining_out_n(const char *s, size_t len, time_t time);
+EXTERN_C
+const char *hrs3_kind_as_string_n(const char *s, size_t len);
+EXTERN_C
+hrs3_compiled *hrs3_compile_n(const char *s, size_t len);
+EXTERN_C
+int hrs3_canonicalize_n(const char *s, size_t len, char *buf, size_t size);
+EXTERN_C
+uint64_t hrs3_hash_n(const char *s, size_t len);
+EXTERN_C
+int hrs3_remaining_batch_n(const char *s, size_t len, const time_t *times, size_t n,
+                           hrs3_result *out);
+EXTERN_C
+int hrs3_remaining_in_tz_n(const char *s, size_t len, const char *zone, time_t time);
+EXTERN_C
+int hrs3_remaining_out_tz_n(const char *s, size_t len, const char *zone, time_t time);
+EXTERN_C
+hrs3_compiled *hrs3_compile_tz_n(const char *s, size_t len, const char *zone);
+
+/*
+ * hrs3_remaining_in, hrs3_remaining_out, and hrs3_kind_as_string can
+ * keep up to 'capacity' compiled schedules, evicting the least
+ * recently used.  Strings that don't compile take an entry too, so
+ * repeating one is a hit rather than another parse, and raw schedules
+ * take one per zone.  The cache is disabled until a capacity is set,
+ * and setting a capacity of 0 disables it again.
+ */
+EXTERN_C
+void hrs3_cache_set_capacity(size_t capacity);
+EXTERN_C
+hrs3_cache_stats hrs3_cache_get_stats(void);
+
+/*
+ * The counts of all threads since the last reset, or since the
+ * process started.  Counting costs an increment of a counter of the
+ * calling thread's own, and can be compiled out by defining STATS as
+ * 0, in which case the counts stay 0.
+ */
+EXTERN_C
+hrs3_stats hrs3_stats_get(void);
+EXTERN_C
+void hrs3_stats_reset(void);
+
+/*
+ * allocator, or malloc if it is null, supplies the shifts of parsed
+ * schedules, compiled ones included, the blocks of the arenas below,
+ * and the schedules built in them that don't fit.  Everything else
+ * comes from malloc: the transition tables and bitmaps of compiled
+ * schedules, the entries of the intern table and of the cache, loaded
+ * zones, and interval iterators and cursors.  Memory is freed by
+ * whichever allocator is set then, and every thread reads it without
+ * a lock, so set it once, before anything is allocated and before any
+ * other thread uses hrs3.
+ *
+ * Evaluating a schedule string, as hrs3_remaining_in does, takes its
+ * temporaries from an arena of the calling thread's, which is reset
+ * after each call, so that once the arena has grown to fit, evaluating
+ * allocates nothing.  hrs3_set_scratch makes buffer, which must stay
+ * valid until replaced, the calling thread's arena instead; what
+ * doesn't fit in it is allocated and freed on each call.  A null
+ * buffer goes back to the arena's own memory.
+ */
+EXTERN_C
+void hrs3_set_allocator(const hrs3_allocator *allocator);
+EXTERN_C
+void hrs3_set_scratch(void *buffer, size_t size);
+
 #endif /* __hrs3_h__ */
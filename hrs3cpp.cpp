@@ -3,79 +3,173 @@
 
 #include "hrs3cpp.h"
 #include "hrs3.h"
+#include <vector>
 typedef int status;
 #include "impl/test.h"
 #include "impl/time.h"
 #include "impl/os.h"
-#ifndef RUN_TESTS
+#if TEST
 #define RUN_TESTS 1
 #endif
 #ifndef while_0
 #define while_0 while ((void)0,0)
 #endif
 
-class AggTime {
-public:
-  AggTime() : _timeIn(0), _timeOut(0) { }
-  void timeIn(int x) {  _timeIn += x; }
-  void timeOut(int x) { _timeOut += x; }
-  int timeIn() const { return _timeIn; }
-  int timeOut() const { return _timeOut; }
-private:
-  int _timeIn;
-  int _timeOut;
-};
-
-Hrs3::Hrs3(string hrsss) : _hrsss(hrsss), _inverted(false)
+Hrs3::Hrs3(string hrsss)
+  : _hrsss(hrsss), _inverted(false), _swapped(false),
+    _compiled(hrs3_compile_n(hrsss.data(), hrsss.size()), hrs3_compiled_free)
 {
-  if (!validate())
+  if (!_compiled)
     _hrsss = "";
-  _kind = hrs3_kind_as_string(hrsss.c_str());
+  _kind = hrs3_kind_as_string_n(hrsss.data(), hrsss.size());
+}
+
+Hrs3::Hrs3(shared_ptr<hrs3_compiled> compiled)
+  : _inverted(false), _swapped(false), _compiled(compiled)
+{
+  _hrsss = canonical();
+  _kind = hrs3_compiled_kind_as_string(compiled.get());
+}
+
+string Hrs3::canonical() const
+{
+  int len = hrs3_compiled_format(_compiled.get(), 0, 0);
+  if (len <= 0)
+    return string();
+  vector<char> buf(len + 1);
+  hrs3_compiled_format(_compiled.get(), &buf[0], buf.size());
+  return string(&buf[0], len);
+}
+
+/*
+ * A daily or weekly schedule becomes its complement.  Others are
+ * evaluated with in and out swapped.
+ */
+void Hrs3::invert()
+{
+  _inverted = !_inverted;
+  shared_ptr<hrs3_compiled> complement(hrs3_compiled_complement(_compiled.get()),
+                                       hrs3_compiled_free);
+  if (!complement) {
+    _swapped = !_swapped;
+    return;
+  }
+  bool inverted = _inverted;
+  *this = Hrs3(complement);
+  _inverted = inverted;
+}
+
+Hrs3 Hrs3::combine(const Hrs3 &other,
+                   hrs3_compiled *(*op)(const hrs3_compiled *, const hrs3_compiled *)) const
+{
+  if (_swapped || other._swapped)
+    return nullHrs3();
+  shared_ptr<hrs3_compiled> combined(op(_compiled.get(), other._compiled.get()),
+                                     hrs3_compiled_free);
+  if (!combined)
+    return nullHrs3();
+  return Hrs3(combined);
+}
+
+Hrs3 Hrs3::operator |(const Hrs3 &other) const
+{
+  return combine(other, hrs3_compiled_union);
+}
+
+Hrs3 Hrs3::operator &(const Hrs3 &other) const
+{
+  return combine(other, hrs3_compiled_intersection);
+}
+
+Hrs3 Hrs3::operator -(const Hrs3 &other) const
+{
+  return combine(other, hrs3_compiled_difference);
 }
 
 int Hrs3::remainingIn(time_t t) const
 {
-  return _inverted
-    ? hrs3_remaining_out(_hrsss.c_str(), t)
-    : hrs3_remaining_in(_hrsss.c_str(), t);
+  hrs3_result result = hrs3_compiled_remaining(_compiled.get(), t);
+  if (!result.is_valid)
+    return -1;
+  return result.is_in != _swapped ? result.seconds : 0;
 }
 
 int Hrs3::remainingOut(time_t t) const
 {
-  return _inverted
-    ? hrs3_remaining_in(_hrsss.c_str(), t)
-    : hrs3_remaining_out(_hrsss.c_str(), t);
+  hrs3_result result = hrs3_compiled_remaining(_compiled.get(), t);
+  if (!result.is_valid)
+    return -1;
+  return result.is_in != _swapped ? 0 : result.seconds;
 }
 
-AggTime Hrs3::aggTime(time_t begin, int sand) const
+/*
+ * An invalid schedule is never in, and one inverted by swapping is in
+ * whenever the schedule is out.
+ */
+AggTime Hrs3::aggTime(time_t begin, long long sand) const
 {
   AggTime aggTime;
-  time_t it = begin;
-  time_t end = begin + sand;
-  int seconds = 0;
-  for (; 0 < sand; it += seconds, sand -= seconds) {
-    seconds = remainingIn(it);
-    if (0 < seconds) {
-      if (sand < seconds) seconds = sand;
-      aggTime.timeIn(seconds);
-    } else {
-      seconds = remainingOut(it);
-      if (sand < seconds) seconds = sand;
-      if (0 == seconds) seconds = sand;
-      aggTime.timeOut(seconds);
-    }
-  }
-  if (it != end) throw runtime_error("aggTime bug");
+  if (sand <= 0)
+    return aggTime;
+  long long in = _compiled ? hrs3_compiled_time_in(_compiled.get(), begin, begin + sand) : 0;
+  if (_swapped)
+    in = sand - in;
+  aggTime.timeIn(in);
+  aggTime.timeOut(sand - in);
   return aggTime;
 }
 
-bool Hrs3::validate()
+Hrs3Intervals Hrs3::intervals(time_t begin, time_t end) const
 {
-  return 0 <= hrs3_remaining_out(_hrsss.c_str(), 1473482239);
+  return Hrs3Intervals(_compiled, begin, end, !_swapped);
+}
+
+struct Hrs3Intervals::iterator::State {
+  State(shared_ptr<hrs3_compiled> compiled, hrs3_intervals *intervals)
+    : compiled(compiled), intervals(intervals) { }
+  ~State() { hrs3_intervals_close(intervals); }
+  shared_ptr<hrs3_compiled> compiled;
+  hrs3_intervals *intervals;
+private:
+  State(const State &);
+  State &operator =(const State &);
+};
+
+Hrs3Intervals::iterator &Hrs3Intervals::iterator::operator ++()
+{
+  hrs3_interval interval;
+  if (_state && hrs3_intervals_next(_state->intervals, &interval))
+    _interval = Interval(interval.start, interval.stop);
+  else
+    _state.reset();
+  return *this;
+}
+
+Hrs3Intervals::Hrs3Intervals(const string &hrsss, time_t begin, time_t end, bool in)
+  : _compiled(hrs3_compile_n(hrsss.data(), hrsss.size()), hrs3_compiled_free),
+    _begin(begin), _end(end), _in(in)
+{
+}
+
+Hrs3Intervals::Hrs3Intervals(shared_ptr<hrs3_compiled> compiled, time_t begin, time_t end,
+                             bool in)
+  : _compiled(compiled), _begin(begin), _end(end), _in(in)
+{
+}
+
+Hrs3Intervals::iterator Hrs3Intervals::begin() const
+{
+  if (!_compiled)
+    return end();
+  hrs3_intervals *intervals = _in
+    ? hrs3_intervals_open(_compiled.get(), _begin, _end)
+    : hrs3_intervals_open_out(_compiled.get(), _begin, _end);
+  return iterator(shared_ptr<iterator::State>(new iterator::State(_compiled, intervals)));
 }
 
 #if RUN_TESTS
 #include <iostream>
+#include <unordered_map>
 
 void test_hrs3_kind()
 {
@@ -139,6 +233,130 @@ void test_hrs3_remainingInWithInversion()
   X(   1, "9-10", 8, 59, 59);
   X(23 * 3600, "8-9",  9,  0,  0);
 #undef X
+  Hrs3 hrs3("8-9");
+  hrs3.invert();
+  if (!hrs3.inverted() || "0-8&9-24" != hrs3.str()) TFAILF("%s", hrs3.str().c_str());
+  hrs3.invert();
+  if (hrs3.inverted() || "8-9" != hrs3.str()) TFAILF("%s", hrs3.str().c_str());
+}
+
+void test_hrs3_combine()
+{
+  struct tm ymdhms = tm();
+  ymdhms.tm_year = 2015 - 1900;
+  ymdhms.tm_mon = 5;
+  ymdhms.tm_mday = 12; // a Friday
+  ymdhms.tm_hour = 13;
+  ymdhms.tm_isdst = -1;
+  time_t t = mktime(&ymdhms);
+  Hrs3 policy = Hrs3("MTWRF9-17") - Hrs3("F13-15");
+  if ("MTWR9-17.F9-13&15-17" != policy.str()) TFAILF("%s", policy.str().c_str());
+  if (0 != policy.remainingIn(t) || 2 * 3600 != policy.remainingOut(t)) TFAIL();
+  Hrs3 onCall = Hrs3("MWF0-12") | Hrs3("MWF12-24");
+  if ("MWF0-24" != onCall.str() || "weekly" != onCall.kind()) TFAIL();
+  if (11 * 3600 != onCall.remainingIn(t)) TFAIL();
+  Hrs3 both = Hrs3("9-17") & Hrs3("MWF8-10");
+  if ("MWF9-10" != both.str()) TFAIL();
+  if (3600 != both.aggTime(t - 13 * 3600, 24 * 3600).timeIn()) TFAIL();
+  Hrs3 never = Hrs3("8-9") - Hrs3("8-9");
+  if (!never.empty() || 0 != never.remainingIn(t) || 0 != never.remainingOut(t)) TFAIL();
+  if (!never.valid() || "daily" != never.kind()) TFAIL();
+  Hrs3 always("0-24");
+  always.invert();
+  if (!always.valid() || "daily" != always.kind() || 0 != always.remainingIn(t)) TFAIL();
+  // the week of 2015-06-07 uses the second half
+  Hrs3 rotation = Hrs3("B2015M8-12|T8-12") | Hrs3("F12-14");
+  if ("B2015M8-12.F12-14|T8-12.F12-14" != rotation.str()) TFAILF("%s", rotation.str().c_str());
+  if ("biweekly" != rotation.kind() || 3600 != rotation.remainingIn(t)) TFAIL();
+  if (67 * 3600 != (rotation - Hrs3("F0-24")).remainingOut(t)) TFAIL();
+  if ((Hrs3("8-9") | Hrs3("20150516120100-20150516120200")).valid()) TFAIL();
+  Hrs3 inverted("20150516120100-20150516120200");
+  inverted.invert();
+  if ((Hrs3("8-9") | inverted).valid()) TFAIL();
+  int n = 0;
+  for (Hrs3Intervals::iterator it = policy.intervals(t, t + 24 * 3600).begin();
+       it != Hrs3Intervals::iterator(); ++it)
+    ++n;
+  if (1 != n) TFAIL();
+}
+
+void test_hrs3_intervals()
+{
+  struct tm ymdhms = tm();
+  ymdhms.tm_year = 2015 - 1900;
+  ymdhms.tm_mon = 5;
+  ymdhms.tm_mday = 8; // a Monday
+  ymdhms.tm_hour = 12;
+  ymdhms.tm_isdst = -1;
+  time_t begin = mktime(&ymdhms);
+  ymdhms.tm_mday = 10;
+  ymdhms.tm_isdst = -1;
+  time_t end = mktime(&ymdhms);
+  Hrs3 hrs3("0-1&23-24");
+  int n = 0;
+  for (Hrs3Intervals::iterator it = hrs3.intervals(begin, end).begin();
+       it != Hrs3Intervals::iterator(); ++it, ++n) {
+    if (2 * 3600 != it->second - it->first) TFAIL();
+    if (begin + 11 * 3600 + n * 24 * 3600 != it->first) TFAIL();
+  }
+  if (2 != n) TFAIL();
+  hrs3.invert();
+  Hrs3Intervals intervals = hrs3.intervals(begin, end);
+  n = 0;
+  time_t t = begin;
+  for (Hrs3Intervals::iterator it = intervals.begin(); it != intervals.end(); ++it, ++n) {
+    if (t != it->first) TFAIL();
+    t = it->second + 2 * 3600;
+  }
+  if (3 != n) TFAIL();
+  if (Hrs3("abc").intervals(begin, end).begin() != Hrs3Intervals::iterator()) TFAIL();
+}
+
+void test_hrs3_aggTime()
+{
+  struct tm ymdhms = tm();
+  ymdhms.tm_year = 2015 - 1900;
+  ymdhms.tm_mon = 5;
+  ymdhms.tm_mday = 8; // a Monday
+  ymdhms.tm_isdst = -1;
+  time_t begin = mktime(&ymdhms);
+#define X(x, inverted, sand, in) do {                                   \
+    Hrs3 hrs3(x);                                                       \
+    if (inverted) hrs3.invert();                                        \
+    AggTime aggTime = hrs3.aggTime(begin, sand);                        \
+    if ((in) != aggTime.timeIn() || (sand) - (in) != aggTime.timeOut()) \
+      TFAILF("%s %lld", x, aggTime.timeIn());                           \
+  } while_0
+  X("MWF9-17", false, 7 * 24 * 3600LL, 3 * 8 * 3600LL);
+  X("MWF9-17", true, 7 * 24 * 3600LL, 7 * 24 * 3600LL - 3 * 8 * 3600LL);
+  X("MWF9-17", false, 10 * 3600LL, 3600LL);
+  X("abc", false, 3600LL, 0LL);
+  X("abc", true, 3600LL, 3600LL);
+  X("UMTWRFA0-24", false, 100 * 365 * 24 * 3600LL, 100 * 365 * 24 * 3600LL);
+#undef X
+  if (0 != Hrs3("8-9").aggTime(begin, -1).timeOut()) TFAIL();
+}
+
+void test_hrs3_canonical()
+{
+  Hrs3 a("MWF10-12.M13-15"), b("M10-12&13-15.WF10-12");
+  if ("M10-12&13-15.WF10-12" != a.canonical()) TFAILF("%s", a.canonical().c_str());
+  if (!(a == b) || a.hash() != b.hash() || hash<Hrs3>()(a) != hash<Hrs3>()(b)) TFAIL();
+  if (Hrs3("8-9") == Hrs3("8-10")) TFAIL();
+  if (Hrs3("1000-1200") != Hrs3("10-12")) TFAIL();
+  if (Hrs3("UMTWRFA8-9") != Hrs3("8-9")) TFAIL();
+  if (Hrs3("BMWF10-12|MWF10-12") != Hrs3("MWF10-12")) TFAIL();
+  if (Hrs3("P9-17") != Hrs3("MTWRF9-17") || "P9-17" != Hrs3("MTWRF9-17").canonical()) TFAIL();
+  if (Hrs3("MWF9-17") - Hrs3("F13-15") != Hrs3("F9-13&15-17.MW9-17")) TFAIL();
+  Hrs3 raw("20150516120100-20150516120200"), inverted(raw);
+  inverted.invert();
+  if (raw == inverted || raw.canonical() != inverted.canonical()) TFAIL();
+  const char *hrsss[] = { "MWF10-12.M13-15", "M10-12&13-15.WF10-12", "8-9", "08:00-09:00",
+                          "UMTWRFA8-9", "now+60m", "now+1h" };
+  unordered_map<Hrs3, int> counts;
+  for (size_t i = 0; i < sizeof(hrsss) / sizeof(hrsss[0]); ++i)
+    ++counts[Hrs3(hrsss[i])];
+  if (3 != counts.size() || 2 != counts[Hrs3("now+3600s")]) TFAIL();
 }
 
 static struct TestHrs3 {
@@ -146,6 +364,10 @@ static struct TestHrs3 {
     test_hrs3_kind();
     test_hrs3_remainingIn();
     test_hrs3_remainingInWithInversion();
+    test_hrs3_intervals();
+    test_hrs3_aggTime();
+    test_hrs3_combine();
+    test_hrs3_canonical();
     Hrs3 hrs3("UMTWRFA0-2359");
     cout << hrs3.aggTime(time(0), 3600 * 24 * 7);
     cout << hrs3.aggTime(1473577140, 3600);
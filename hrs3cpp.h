@@ -1,11 +1,28 @@
 #ifndef __hrs3cpp_h__
 #define __hrs3cpp_h__
 
+#include <functional>
 #include <string>
 #include <stdexcept>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include "hrs3.h"
 using namespace std;
 
-class AggTime;
+class Hrs3Intervals;
+
+class AggTime {
+public:
+  AggTime() : _timeIn(0), _timeOut(0) { }
+  void timeIn(long long x) {  _timeIn += x; }
+  void timeOut(long long x) { _timeOut += x; }
+  long long timeIn() const { return _timeIn; }
+  long long timeOut() const { return _timeOut; }
+private:
+  long long _timeIn;
+  long long _timeOut;
+};
 
 class Hrs3 {
 public:
@@ -13,21 +30,85 @@ public:
     return Hrs3("");
   }
   Hrs3(string hrsss = "");
-  void invert() { _inverted = !_inverted; }
+  void invert();
   bool inverted() const { return _inverted; }
   bool empty() const { return _hrsss.empty(); }
-  bool valid() const { return !empty(); }
+  bool valid() const { return _compiled.get() != 0; }
   string str() const { return _hrsss; }
   string kind() const { return _kind; }
-  bool operator ==(const Hrs3 &other) const { return _hrsss == other._hrsss; }
+  // Schedules are equal if they mean the same, whatever their strings,
+  // since then they share one compiled schedule.
+  string canonical() const;
+  uint64_t hash() const { return hrs3_compiled_hash(_compiled.get()); }
+  bool operator ==(const Hrs3 &other) const {
+    return _compiled == other._compiled && _swapped == other._swapped;
+  }
+  bool operator !=(const Hrs3 &other) const { return !(*this == other); }
   int remainingIn(time_t t) const;
   int remainingOut(time_t t) const;
-  AggTime aggTime(time_t begin, int sand) const;
+  AggTime aggTime(time_t begin, long long sand) const;
+  Hrs3Intervals intervals(time_t begin, time_t end) const;
+  // Combinations of daily, weekly and biweekly schedules, which are as
+  // fast to evaluate as either one.  Combining a raw or now schedule, or
+  // an inverted one, gives an invalid Hrs3.
+  Hrs3 operator |(const Hrs3 &other) const;
+  Hrs3 operator &(const Hrs3 &other) const;
+  Hrs3 operator -(const Hrs3 &other) const;
 private:
-  bool validate();
+  explicit Hrs3(shared_ptr<hrs3_compiled> compiled);
+  Hrs3 combine(const Hrs3 &other,
+               hrs3_compiled *(*op)(const hrs3_compiled *, const hrs3_compiled *)) const;
   string _hrsss;
   string _kind;
   bool _inverted;
+  bool _swapped; // inverted by swapping in and out, for raw and now schedules
+  // The interned schedule that is evaluated, null if invalid
+  shared_ptr<hrs3_compiled> _compiled;
+};
+
+/*
+ * The intervals of a schedule within [begin, end), as [start, stop)
+ * pairs that are found as they are iterated.  See hrs3_intervals_open.
+ */
+class Hrs3Intervals {
+public:
+  typedef pair<time_t, time_t> Interval;
+  class iterator {
+  public:
+    typedef input_iterator_tag iterator_category;
+    typedef Interval value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const Interval *pointer;
+    typedef const Interval &reference;
+    iterator() { }
+    reference operator *() const { return _interval; }
+    pointer operator ->() const { return &_interval; }
+    iterator &operator ++();
+    iterator operator ++(int) { iterator it = *this; ++*this; return it; }
+    bool operator ==(const iterator &other) const { return _state == other._state; }
+    bool operator !=(const iterator &other) const { return _state != other._state; }
+  private:
+    friend class Hrs3Intervals;
+    struct State;
+    explicit iterator(shared_ptr<State> state) : _state(state) { ++*this; }
+    shared_ptr<State> _state; // null at the end
+    Interval _interval;
+  };
+  Hrs3Intervals(const string &hrsss, time_t begin, time_t end, bool in);
+  Hrs3Intervals(shared_ptr<hrs3_compiled> compiled, time_t begin, time_t end, bool in);
+  iterator begin() const;
+  iterator end() const { return iterator(); }
+private:
+  shared_ptr<hrs3_compiled> _compiled;
+  time_t _begin;
+  time_t _end;
+  bool _in;
+};
+
+namespace std {
+template <> struct hash<Hrs3> {
+  size_t operator ()(const Hrs3 &hrs3) const { return (size_t)hrs3.hash(); }
 };
+}
 
 #endif // __hrs3cpp_h__
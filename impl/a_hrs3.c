@@ -4,12 +4,12 @@
 #include "impl.h"
 #include <string.h>
 
-a_hrs3_kind hrs3_kind(const char *s)
+a_hrs3_kind hrs3_kind(const char *s, size_t len)
 {
-  if (!s) return Invalid;
-  const char *dash = strchr(s, '-');
+  if (!s || !len) return Invalid;
+  const char *dash = strnchr(s, len, '-');
   if (!dash) {
-    if ('n' == s[0] && 'o' == s[1] && 'w' == s[2])
+    if (3 <= len && 'n' == s[0] && 'o' == s[1] && 'w' == s[2])
       return Now;
     return Invalid;
   }
@@ -23,10 +23,12 @@ a_hrs3_kind hrs3_kind(const char *s)
      *  20-21 (8pm to 9pm) or
      *  2000-21 (8pm to 9pm) or
      *  20-2100 (8pm to 9pm).
+     * Colons, as in 20:15-22:15, don't count.
      */
-    if (dash - s == 14)
+    size_t n_digits = dash - s - strncount(s, dash - s, ':');
+    if (n_digits == 14)
       return Raw;
-    else if (dash - s <= 4)
+    else if (n_digits <= 4)
       return Daily;
     else
       return Invalid;
@@ -54,6 +56,18 @@ static status hrs3_parse_weekly(a_hrs3 *hrs3, const char *hrsss, size_t len)
   return week_init(week, hrsss, len);
 }
 
+static status hrs3_parse_weekdaily(a_hrs3 *hrs3, const char *hrsss, size_t len)
+{
+  a_week week_, *week = hrs3 ? &hrs3->week : &week_;
+  return week_init_weekdaily(week, hrsss, len);
+}
+
+static status hrs3_parse_biweekly(a_hrs3 *hrs3, const char *hrsss, size_t len)
+{
+  a_biweek biweek_, *biweek = hrs3 ? &hrs3->biweek : &biweek_;
+  return biweek_init(biweek, hrsss, len);
+}
+
 static status hrs3_parse_raw(a_hrs3 *hrs3, const char *hrsss, size_t len)
 {
   a_time_range time_range_, *time_range = hrs3 ? &hrs3->time_range : &time_range_;
@@ -66,24 +80,46 @@ static status hrs3_parse_now(a_hrs3 *hrs3, const char *hrsss, size_t len)
   return now_init(now_range, hrsss, len);
 }
 
+/*
+ * Add the shifts of hrs3 around t to schedule.  They are appended,
+ * and then sorted and merged all at once.
+ */
 void hrs3_add_to_schedule(a_hrs3 *hrs3, const a_time *t, a_schedule *schedule)
 {
   switch(hrs3->kind) {
   case Daily: day_add_to_schedule(&hrs3->day, t, schedule); break;
+  case Weekdaily:
   case Weekly: week_add_to_schedule(&hrs3->week, t, schedule); break;
-  case Raw: schedule_insert(schedule, &hrs3->time_range); break;
+  case Biweekly: biweek_add_to_schedule(&hrs3->biweek, t, schedule); break;
+  case Raw: schedule_append(schedule, &hrs3->time_range); break;
   case Now: now_add_to_schedule(&hrs3->now_range, t, schedule); break;
   default: break;
   }
+  schedule_normalize(schedule);
 }
 
-a_remaining_result hrs3_remaining(a_hrs3 *hrs3, const a_time *t)
+/* Move t to the next day or week of a periodic hrs3, where its shifts repeat. */
+static bool hrs3_next_period(const a_hrs3 *hrs3, a_time *t)
+{
+  if (Daily == hrs3->kind)
+    time_next_day(t);
+  else if (Weekdaily == hrs3->kind || Weekly == hrs3->kind || Biweekly == hrs3->kind)
+    time_next_week(t);
+  else
+    return false;
+  return true;
+}
+
+static a_remaining_result hrs3_remaining_from(a_hrs3 *hrs3, const a_time *t, bool carries_on)
 {
   a_schedule schedule_, *schedule = &schedule_;
   schedule_init(schedule);
   hrs3_add_to_schedule(hrs3, t, schedule);
   a_remaining_result result = schedule_remaining(schedule, t);
   schedule_destroy(schedule);
+  if (!result.is_valid)
+    return result;
+  a_time next_time_ = time_clone(t), *next_time = &next_time_;
   if (!result.time_is_in_schedule && 0 == result.seconds) {
     /*
      * t occurs after all ranges in schedule.  Look forward to the
@@ -91,33 +127,63 @@ a_remaining_result hrs3_remaining(a_hrs3 *hrs3, const a_time *t)
      * to handle time ranges that start at midnight on the next day or
      * week.
      */
-    a_time next_time_ = time_clone(t), *next_time = &next_time_;
-    if (Daily == hrs3->kind)
-      time_next_day(next_time);
-    else if (Weekly == hrs3->kind)
-      time_next_week(next_time);
-    else
+    if (!hrs3_next_period(hrs3, next_time))
       return result;
-    a_remaining_result next_result = hrs3_remaining(hrs3, next_time);
+    STATS_INCR(STAT_LOOKAHEADS);
+    a_remaining_result next_result = hrs3_remaining_from(hrs3, next_time, false);
+    if (!next_result.is_valid)
+      return next_result;
     if (next_result.time_is_in_schedule)
       /* The shift starts at the very beginning of the next day or week. */
       result.seconds = time_diff(next_time, t);
     else
       result.seconds = time_diff(next_time, t) + next_result.seconds;
+  } else if (result.time_is_in_schedule && carries_on) {
+    /*
+     * A shift that lasts until the end of the day or week carries on
+     * into one that starts the next, and for a biweekly schedule
+     * maybe through a week that is in throughout and into the week
+     * after that.  A schedule that is always in is in until the end
+     * of the day or week.
+     */
+    unsigned int seconds = result.seconds;
+    int i = 0;
+    for (; i < 3; ++i) {
+      if (!hrs3_next_period(hrs3, next_time) || time_diff(next_time, t) != (int)seconds)
+        break;
+      if (2 == i)
+        return result;
+      STATS_INCR(STAT_LOOKAHEADS);
+      a_remaining_result next_result = hrs3_remaining_from(hrs3, next_time, false);
+      if (!next_result.is_valid)
+        return next_result;
+      if (!next_result.time_is_in_schedule)
+        break;
+      seconds += next_result.seconds;
+    }
+    result.seconds = seconds;
   }
   return result;
 }
 
+a_remaining_result hrs3_remaining(a_hrs3 *hrs3, const a_time *t)
+{
+  return hrs3_remaining_from(hrs3, t, true);
+}
+
 status hrs3_init(a_hrs3 *hrs3, const char *hrsss, size_t len)
 {
-  a_hrs3_kind kind = hrs3_kind(hrsss);
+  a_hrs3_kind kind = hrs3_kind(hrsss, len);
+  STATS_INCR(STAT_PARSES);
   if (hrs3) {
     memset(hrs3, 0, sizeof(a_hrs3));
     hrs3->kind = kind;
   }
   switch (kind) {
   case Daily: return hrs3_parse_daily(hrs3, hrsss, len);
+  case Weekdaily: return hrs3_parse_weekdaily(hrs3, hrsss, len);
   case Weekly: return hrs3_parse_weekly(hrs3, hrsss, len);
+  case Biweekly: return hrs3_parse_biweekly(hrs3, hrsss, len);
   case Raw: return hrs3_parse_raw(hrs3, hrsss, len);
   case Now: return hrs3_parse_now(hrs3, hrsss, len);
   default: return NO;
@@ -128,7 +194,9 @@ void hrs3_destroy(a_hrs3 *hrs3)
 {
   switch (hrs3->kind) {
   case Daily: day_destroy(&hrs3->day); break;
+  case Weekdaily:
   case Weekly: week_destroy(&hrs3->week); break;
+  case Biweekly: biweek_destroy(&hrs3->biweek); break;
   case Raw: break;
   case Now: break;
   default: break;
@@ -139,18 +207,22 @@ void hrs3_destroy(a_hrs3 *hrs3)
 #if RUN_TESTS
 int test_hrs3_kind(void)
 {
-#define X(x) if (!(x)) TFAIL();
-  X(Invalid == hrs3_kind(0));
-  X(Invalid == hrs3_kind(""));
-  X(Daily == hrs3_kind("8-12"));
-  X(Weekdaily == hrs3_kind("P8-12"));
-  X(Weekly == hrs3_kind("MWF8-12"));
-  X(Biweekly == hrs3_kind("BM8-12|T8-12"));
-  X(Raw == hrs3_kind("20150516121900-20150516122000"));
-  X(Raw == hrs3_kind("_20150516121900-20150516122000"));
-  X(Raw == hrs3_kind("_1900-2100"));
-  X(Now == hrs3_kind("now+30m"));
+#define X(KIND, S) if (KIND != hrs3_kind(S, sizeof(S) - 1)) TFAILF(" %s", S);
+  if (Invalid != hrs3_kind(0, 0)) TFAIL();
+  X(Invalid, "");
+  X(Daily, "8-12");
+  X(Daily, "10:00-11:30");
+  X(Weekdaily, "P8-12");
+  X(Weekly, "MWF8-12");
+  X(Biweekly, "BM8-12|T8-12");
+  X(Raw, "20150516121900-20150516122000");
+  X(Raw, "_20150516121900-20150516122000");
+  X(Raw, "_1900-2100");
+  X(Now, "now+30m");
 #undef X
+  /* only the first len characters count */
+  if (Invalid != hrs3_kind("8-12", 1)) TFAIL();
+  if (Invalid != hrs3_kind("now+30m", 2)) TFAIL();
   return OK;
 }
 
@@ -161,7 +233,9 @@ PRE_INIT(test_hrs3_)
 #endif /* RUN_TESTS */
 
 #ifdef ONE_OBJ
+#include "biweekly.c"
 #include "daily.c"
+#include "stats.c"
 #include "weekly.c"
 #endif
 
@@ -1,6 +1,7 @@
 #ifndef __a_hrs3_h__
 #define __a_hrs3_h__
 
+#include "biweekly.h"
 #include "daily.h"
 #include "remaining.h"
 #include "time_range.h"
@@ -27,12 +28,13 @@ typedef struct a_hrs3 {
   union {
     a_day day;
     a_week week;
+    a_biweek biweek;
     a_time_range time_range;
     a_now_range now_range;
   };
 } a_hrs3;
 
-a_hrs3_kind hrs3_kind(const char *s);
+a_hrs3_kind hrs3_kind(const char *s, size_t len);
 status hrs3_init(a_hrs3 *hrs3, const char *buffer, size_t len);
 a_remaining_result hrs3_remaining(a_hrs3 *hrs3, const a_time *t);
 void hrs3_destroy(a_hrs3 *);
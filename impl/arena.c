@@ -0,0 +1,291 @@
+#ifndef __arena_c__
+#define __arena_c__
+
+#include "impl.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Sizes are rounded up to this, so that any range or pointer fits. */
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_SIZE 4096
+
+static void *arena_malloc_(void *context, size_t size)
+{
+  (void)context;
+  return malloc(size);
+}
+
+static void *arena_realloc_(void *context, void *p, size_t size)
+{
+  (void)context;
+  return realloc(p, size);
+}
+
+static void arena_free_(void *context, void *p)
+{
+  (void)context;
+  free(p);
+}
+
+#define ARENA_DEFAULT_ALLOCATOR { arena_malloc_, arena_realloc_, arena_free_, 0 }
+static a_allocator arena_allocator = ARENA_DEFAULT_ALLOCATOR;
+
+static THREAD_LOCAL a_arena arena_mine;
+
+#if !_WIN32
+/* When a thread exits, its arena's block is freed.  On Windows, it leaks. */
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t arena_key;
+
+static void arena_release(void *base)
+{
+  arena_allocator.free(arena_allocator.context, base);
+}
+
+static void arena_key_create(void)
+{
+  pthread_key_create(&arena_key, arena_release);
+}
+#endif
+
+/*
+ * Replace the allocator, or go back to malloc if allocator is null.
+ * Memory is freed by whichever allocator is set then, and threads read
+ * it without a lock, so set it before anything is allocated and before
+ * other threads start.
+ */
+void arena_set_allocator(const a_allocator *allocator)
+{
+  static const a_allocator default_allocator = ARENA_DEFAULT_ALLOCATOR;
+  arena_allocator = allocator ? *allocator : default_allocator;
+}
+
+/* Give this thread's arena the block base of size bytes, or none. */
+static void arena_set_base(a_arena *arena, char *base, size_t size, bool is_scratch)
+{
+  if (arena->base && !arena->is_scratch)
+    arena_allocator.free(arena_allocator.context, arena->base);
+  arena->base = base;
+  arena->size = size;
+  arena->is_scratch = is_scratch;
+#if !_WIN32
+  pthread_once(&arena_once, arena_key_create);
+  pthread_setspecific(arena_key, is_scratch ? 0 : base);
+#endif
+}
+
+/*
+ * Use buffer, which must stay valid until replaced, as this thread's
+ * arena, or go back to the arena's own block if buffer is null.
+ */
+void arena_set_scratch(void *buffer, size_t size)
+{
+  a_arena *arena = &arena_mine;
+  if (arena->depth)
+    return;
+  size_t skip = buffer ? (ARENA_ALIGNMENT - (uintptr_t)buffer % ARENA_ALIGNMENT) % ARENA_ALIGNMENT : 0;
+  if (size <= skip)
+    buffer = 0;
+  arena_set_base(arena, buffer ? (char *)buffer + skip : 0, buffer ? size - skip : 0,
+                 buffer ? true : false);
+}
+
+void arena_begin(void)
+{
+  arena_mine.depth += 1;
+}
+
+/*
+ * Free everything allocated since the outermost arena_begin.  If some
+ * of it didn't fit, grow the arena's block to fit it next time.
+ */
+void arena_end(void)
+{
+  a_arena *arena = &arena_mine;
+  if (--arena->depth)
+    return;
+  size_t needed = arena->used + arena->overflow_size;
+  while (arena->overflows) {
+    a_arena_overflow *next = arena->overflows->next;
+    arena_allocator.free(arena_allocator.context, arena->overflows);
+    arena->overflows = next;
+  }
+  if (arena->overflow_size && !arena->is_scratch) {
+    size_t size = 2 * arena->size;
+    if (size < needed)
+      size = needed;
+    if (size < ARENA_MIN_SIZE)
+      size = ARENA_MIN_SIZE;
+    char *base = arena_allocator.malloc(arena_allocator.context, size);
+    arena_set_base(arena, base, base ? size : 0, false);
+  }
+  arena->used = 0;
+  arena->overflow_size = 0;
+}
+
+static bool arena_owns(const a_arena *arena, const void *p)
+{
+  const char *c = p;
+  if (arena->base && arena->base <= c && c < arena->base + arena->size)
+    return true;
+  const a_arena_overflow *overflow = arena->overflows;
+  for (; overflow; overflow = overflow->next)
+    if ((const char *)overflow + ARENA_ALIGNMENT == c)
+      return true;
+  return false;
+}
+
+void *arena_alloc(size_t size)
+{
+  a_arena *arena = &arena_mine;
+  if (!arena->depth)
+    return arena_allocator.malloc(arena_allocator.context, size);
+  size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+  if (size <= arena->size - arena->used) {
+    void *p = arena->base + arena->used;
+    arena->used += size;
+    return p;
+  }
+  /* header is ARENA_ALIGNMENT bytes, so what follows is aligned */
+  a_arena_overflow *overflow =
+    arena_allocator.malloc(arena_allocator.context, ARENA_ALIGNMENT + size);
+  if (!overflow)
+    return 0;
+  overflow->next = arena->overflows;
+  overflow->size = size;
+  arena->overflows = overflow;
+  arena->overflow_size += size;
+  return (char *)overflow + ARENA_ALIGNMENT;
+}
+
+/*
+ * Memory from an arena stays in it, and other memory goes to the
+ * allocator.  Like realloc, it returns null and leaves p alone if
+ * there's no memory.
+ */
+void *arena_realloc(void *p, size_t old_size, size_t size)
+{
+  a_arena *arena = &arena_mine;
+  if (!p)
+    return arena_alloc(size);
+  if (!arena->depth || !arena_owns(arena, p))
+    return arena_allocator.realloc(arena_allocator.context, p, size);
+  void *q = arena_alloc(size);
+  if (!q)
+    return 0;
+  memcpy(q, p, old_size < size ? old_size : size);
+  return q;
+}
+
+void arena_free(void *p)
+{
+  a_arena *arena = &arena_mine;
+  if (!p || (arena->depth && arena_owns(arena, p)))
+    return;
+  arena_allocator.free(arena_allocator.context, p);
+}
+
+#if RUN_TESTS
+static int test_arena_n_mallocs;
+
+static void *test_arena_malloc(void *context, size_t size)
+{
+  (void)context;
+  ++test_arena_n_mallocs;
+  return malloc(size);
+}
+
+static void test_arena_steady(void)
+{
+  a_allocator counting = { test_arena_malloc, arena_realloc_, arena_free_, 0 };
+  arena_set_allocator(&counting);
+  int round = 0;
+  for (; round < 3; ++round) {
+    test_arena_n_mallocs = 0;
+    arena_begin();
+    char *p = arena_alloc(100);
+    memset(p, 1, 100);
+    p = arena_realloc(p, 100, 10000);
+    if (1 != p[99]) TFAIL();
+    arena_free(p);
+    arena_end();
+    /* the first round grows the arena, and later ones allocate nothing */
+    if (round && test_arena_n_mallocs) TFAILF(" %d", test_arena_n_mallocs);
+  }
+  /* outside of arena_begin and arena_end, memory is the allocator's */
+  test_arena_n_mallocs = 0;
+  void *q = arena_alloc(10);
+  if (1 != test_arena_n_mallocs) TFAIL();
+  arena_begin();
+  arena_free(q);
+  arena_end();
+  arena_set_scratch(0, 0);
+  arena_set_allocator(0);
+}
+
+static void test_arena_scratch(void)
+{
+  char scratch[256];
+  arena_set_scratch(scratch, sizeof(scratch));
+  arena_begin();
+  char *p = arena_alloc(100);
+  if (p < scratch || scratch + sizeof(scratch) <= p) TFAIL();
+  if ((uintptr_t)p % ARENA_ALIGNMENT) TFAIL();
+  char *q = arena_alloc(1000);
+  if (scratch <= q && q < scratch + sizeof(scratch)) TFAIL();
+  arena_end();
+  arena_begin();
+  if (p != arena_alloc(100)) TFAIL();
+  arena_end();
+  arena_set_scratch(0, 0);
+}
+
+static void *test_arena_no_malloc(void *context, size_t size)
+{
+  (void)context;
+  (void)size;
+  return 0;
+}
+
+static void test_arena_out_of_memory(void)
+{
+  char scratch[256];
+  arena_set_scratch(scratch, sizeof(scratch));
+  a_allocator none = { test_arena_no_malloc, arena_realloc_, arena_free_, 0 };
+  arena_set_allocator(&none);
+  arena_begin();
+  char *p = arena_alloc(100);
+  if (!p) TFAIL();
+  if (arena_alloc(1000) || arena_realloc(p, 100, 1000)) TFAIL();
+  arena_end();
+  arena_set_allocator(0);
+  arena_set_scratch(0, 0);
+  /* an arena of its own that can't grow stays empty */
+  arena_set_allocator(&none);
+  arena_begin();
+  if (arena_alloc(100)) TFAIL();
+  arena_end();
+  if (arena_mine.base || arena_mine.size) TFAIL();
+  arena_set_allocator(0);
+}
+
+PRE_INIT(test_arena)
+{
+  test_arena_steady();
+  test_arena_scratch();
+  test_arena_out_of_memory();
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o arena arena.c && ./arena"
+ * End:
+ */
+
+#endif /* __arena_c__ */
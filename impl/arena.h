@@ -0,0 +1,50 @@
+#ifndef __arena_h__
+#define __arena_h__
+
+#include "os.h"
+#include <stddef.h>
+
+/*
+ * arena - Memory for the shifts of schedules and for evaluating them.
+ *
+ * It comes from an allocator that callers can replace, malloc by
+ * default.  Between arena_begin and arena_end, new memory instead comes
+ * from the calling thread's arena, which is bumped through and reset
+ * at the end, so that once it has grown to fit, evaluating allocates
+ * nothing.  The arena is either a block of its own or a buffer the
+ * caller passed to arena_set_scratch; what doesn't fit is allocated
+ * and freed at the end, and makes the arena's own block grow.
+ */
+
+typedef struct a_allocator {
+  void *(*malloc)(void *context, size_t size);
+  void *(*realloc)(void *context, void *p, size_t size);
+  void (*free)(void *context, void *p);
+  void *context;
+} a_allocator;
+
+/* What didn't fit in an arena, freed at arena_end */
+typedef struct a_arena_overflow {
+  struct a_arena_overflow *next;
+  size_t size;
+} a_arena_overflow;
+
+typedef struct a_arena {
+  char *base;
+  size_t size;
+  size_t used;
+  bool is_scratch;             /* base is the caller's */
+  a_arena_overflow *overflows;
+  size_t overflow_size;        /* of all overflows since arena_begin */
+  int depth;                   /* of nested arena_begin calls */
+} a_arena;
+
+void arena_set_allocator(const a_allocator *allocator);
+void arena_set_scratch(void *buffer, size_t size);
+void arena_begin(void);
+void arena_end(void);
+void *arena_alloc(size_t size);
+void *arena_realloc(void *p, size_t old_size, size_t size);
+void arena_free(void *p);
+
+#endif /* __arena_h__ */
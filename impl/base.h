@@ -10,6 +10,9 @@
 #  endif
 #  define RUN_TESTS 1
 #endif
+#ifndef STATS
+#  define STATS 1
+#endif
 #if CHECK
 #  define BUG() CRASH()
 #else
@@ -29,6 +32,7 @@ struct a_day;
 struct a_schedule;
 struct a_time;
 struct a_time_range;
+struct a_tz;
 
 #include <stddef.h>
 
@@ -0,0 +1,143 @@
+#ifndef __bitmap_c__
+#define __bitmap_c__
+
+#include "impl.h"
+#include <string.h>
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+status bitmap_init(a_bitmap *bitmap, int n_bits)
+{
+  /* round up to whole cache lines */
+  int words_per_line = BITMAP_ALIGNMENT / sizeof(uint64_t);
+  int n_words = (n_bits + 63) / 64;
+  n_words = (n_words + words_per_line - 1) / words_per_line * words_per_line;
+  size_t size = sizeof(uint64_t) * (n_words ? n_words : words_per_line);
+  bitmap->n_bits = n_bits;
+  bitmap->n_words = n_words;
+  bitmap->words = ALIGNED_ALLOC(BITMAP_ALIGNMENT, size);
+  if (!bitmap->words) {
+    bitmap->n_bits = 0;
+    bitmap->n_words = 0;
+    return NO;
+  }
+  memset(bitmap->words, 0, size);
+  return OK;
+}
+
+void bitmap_destroy(a_bitmap *bitmap)
+{
+  if (bitmap->words)
+    ALIGNED_FREE(bitmap->words);
+  bitmap->n_bits = 0;
+  bitmap->n_words = 0;
+  bitmap->words = 0;
+}
+
+/* Set bits start through stop - 1. */
+void bitmap_set_range(a_bitmap *bitmap, int start, int stop)
+{
+#if CHECK
+  if (start < 0 || bitmap->n_bits < stop)
+    BUG();
+#endif
+  for (; start < stop && start % 64; ++start)
+    bitmap->words[start / 64] |= (uint64_t)1 << (start % 64);
+  for (; start + 64 <= stop; start += 64)
+    bitmap->words[start / 64] = ~(uint64_t)0;
+  for (; start < stop; ++start)
+    bitmap->words[start / 64] |= (uint64_t)1 << (start % 64);
+}
+
+bool bitmap_test(const a_bitmap *bitmap, int bit)
+{
+  return (bitmap->words[bit / 64] >> (bit % 64)) & 1 ? true : false;
+}
+
+/*
+ * bitmap_find returns the first bit at or after 'from' whose value is
+ * 'value', or -1 if there is none.  Runs of bits that don't match are
+ * skipped a word at a time, or two words at a time with SSE2.
+ */
+int bitmap_find(const a_bitmap *bitmap, int from, bool value)
+{
+  if (from < 0)
+    from = 0;
+  if (bitmap->n_bits <= from)
+    return -1;
+  /* after flipping, the wanted bits are 1 */
+  uint64_t flip = value ? 0 : ~(uint64_t)0;
+  const uint64_t *words = bitmap->words;
+  int i = from / 64;
+  uint64_t word = (words[i] ^ flip) & (~(uint64_t)0 << (from % 64));
+  for (;;) {
+    if (word) {
+      int bit = 64 * i + CTZ64(word);
+      return bit < bitmap->n_bits ? bit : -1;
+    }
+    ++i;
+#if __SSE2__
+    __m128i skip = _mm_set1_epi8(value ? 0 : -1);
+    while (i + 2 <= bitmap->n_words) {
+      __m128i x = _mm_loadu_si128((const __m128i *)&words[i]);
+      if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(x, skip)))
+        break;
+      i += 2;
+    }
+#endif
+    if (bitmap->n_words <= i)
+      return -1;
+    word = words[i] ^ flip;
+  }
+}
+
+#if RUN_TESTS
+static void test_bitmap_find(void)
+{
+  a_bitmap bitmap;
+  if (OK != bitmap_init(&bitmap, 7 * 24 * 60)) TFAIL();
+  if (0 != (uintptr_t)bitmap.words % BITMAP_ALIGNMENT) TFAIL();
+  if (-1 != bitmap_find(&bitmap, 0, true)) TFAIL();
+  if (0 != bitmap_find(&bitmap, 0, false)) TFAIL();
+  if (-1 != bitmap_find(&bitmap, 7 * 24 * 60, false)) TFAIL();
+  bitmap_set_range(&bitmap, 63, 130);
+  bitmap_set_range(&bitmap, 5000, 5001);
+  bitmap_set_range(&bitmap, 7 * 24 * 60 - 1, 7 * 24 * 60);
+#define X(FROM, VALUE, EXPECTED) do {                                 \
+    int x = bitmap_find(&bitmap, FROM, VALUE);                        \
+    if (EXPECTED != x) TFAILF(" %d vs %d", EXPECTED, x);              \
+  } while_0
+  X(   0, true,    63);
+  X(  63, true,    63);
+  X(  63, false,  130);
+  X( 129, true,   129);
+  X( 130, true,  5000);
+  X(5000, false, 5001);
+  X(5001, true,  7 * 24 * 60 - 1);
+  X(7 * 24 * 60 - 1, false, -1);
+#undef X
+  if (bitmap_test(&bitmap, 62)) TFAIL();
+  if (!bitmap_test(&bitmap, 63)) TFAIL();
+  if (!bitmap_test(&bitmap, 129)) TFAIL();
+  if (bitmap_test(&bitmap, 130)) TFAIL();
+  bitmap_destroy(&bitmap);
+}
+
+PRE_INIT(test_bitmap)
+{
+  test_bitmap_find();
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o bitmap bitmap.c && ./bitmap"
+ * End:
+ */
+
+#endif /* __bitmap_c__ */
@@ -0,0 +1,25 @@
+#ifndef __bitmap_h__
+#define __bitmap_h__
+
+#include <stdint.h>
+
+/*
+ * bitmap - A fixed-size set of bits, stored in cache-line aligned
+ * 64-bit words.  Bits past n_bits are always 0.
+ */
+
+#define BITMAP_ALIGNMENT 64
+
+typedef struct a_bitmap {
+  int n_bits;
+  int n_words;
+  uint64_t *words;
+} a_bitmap;
+
+status bitmap_init(a_bitmap *bitmap, int n_bits);
+void bitmap_destroy(a_bitmap *bitmap);
+void bitmap_set_range(a_bitmap *bitmap, int start, int stop);
+bool bitmap_test(const a_bitmap *bitmap, int bit);
+int bitmap_find(const a_bitmap *bitmap, int from, bool value);
+
+#endif /* __bitmap_h__ */
@@ -0,0 +1,175 @@
+#ifndef __biweekly_c__
+#define __biweekly_c__
+
+#include "impl.h"
+#include <string.h>
+
+/* The number of characters of s, up to 4, that are a year. */
+static size_t gobble_year(const char *s, size_t len, int *year)
+{
+  if (len < 4 || s[0] < '1' || '9' < s[0])
+    return 0;
+  int y = 0;
+  size_t i = 0;
+  for (; i < 4; ++i) {
+    if (s[i] < '0' || '9' < s[i])
+      return 0;
+    y = 10 * y + s[i] - '0';
+  }
+  *year = y;
+  return 4;
+}
+
+/* B2015M8-12|T8-12 */
+status biweek_init(a_biweek *biweek, const char *s, size_t len)
+{
+  if (biweek)
+    memset(biweek, 0, sizeof(a_biweek));
+  if (0 == len || 'B' != *s)
+    return NO;
+  s += 1;
+  len -= 1;
+  int year = BIWEEK_DEFAULT_YEAR;
+  size_t offset = gobble_year(s, len, &year);
+  s += offset;
+  len -= offset;
+  if (biweek)
+    biweek->year = year;
+  const char *bar = strnchr(s, len, '|');
+  size_t first_len = bar ? (size_t)(bar - s) : len;
+  NOD(week_init(biweek ? &biweek->weeks[0] : 0, s, first_len));
+  if (!bar)
+    return OK;
+  s += first_len + 1;
+  len -= first_len + 1;
+  if (OK != week_init(biweek ? &biweek->weeks[1] : 0, s, len)) {
+    biweek_destroy(biweek);
+    return NO;
+  }
+  return OK;
+}
+
+void biweek_destroy(a_biweek *biweek)
+{
+  if (!biweek) return;
+  week_destroy(&biweek->weeks[0]);
+  week_destroy(&biweek->weeks[1]);
+}
+
+/* Days since 1970-01-01 of the Sunday that starts the first week of year. */
+int64_t biweek_first_sunday(int year)
+{
+  int64_t days = tz_days_from_civil(year, 1, 1);
+  int64_t wday = (days % 7 + 7 + 4) % 7; /* 1970-01-01 was a Thursday */
+  return days - wday;
+}
+
+/* Which half of the schedule the week of tm uses, 0 or 1. */
+int biweek_parity(int year, const struct tm *tm)
+{
+  int64_t sunday =
+    tz_days_from_civil(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday) - tm->tm_wday;
+  return (int)(((sunday - biweek_first_sunday(year)) / 7) & 1);
+}
+
+void biweek_add_to_schedule(const a_biweek *biweek, const a_time *t, a_schedule *schedule)
+{
+  week_add_to_schedule(&biweek->weeks[biweek_parity(biweek->year, time_tm(t))], t, schedule);
+}
+
+#if RUN_TESTS
+static void test_biweek_init(void)
+{
+  a_biweek biweek;
+  if (OK != biweek_init(&biweek, "B2015M8-12|T8-12", 16)) TFAIL();
+  if (2015 != biweek.year) TFAIL();
+  if (1 != biweek.weeks[0].days[1].n_ranges || biweek.weeks[0].days[2].n_ranges) TFAIL();
+  if (1 != biweek.weeks[1].days[2].n_ranges || biweek.weeks[1].days[1].n_ranges) TFAIL();
+  biweek_destroy(&biweek);
+  if (OK != biweek_init(&biweek, "BMWF10-12", 9)) TFAIL();
+  if (BIWEEK_DEFAULT_YEAR != biweek.year) TFAIL();
+  if (1 != biweek.weeks[0].days[5].n_ranges || biweek.weeks[1].days[5].n_ranges) TFAIL();
+  biweek_destroy(&biweek);
+#define BAD(S) if (OK == biweek_init(0, S, strlen(S))) TFAIL()
+  BAD("B");
+  BAD("B2015");
+  BAD("B2015|M8-9");
+  BAD("B2015M8-9|");
+  BAD("B2015M8-9|X8-9");
+  BAD("B015M8-9");
+  BAD("M8-9");
+#undef BAD
+}
+
+static void test_biweek_parity(void)
+{
+#define X(YEAR, Y, M, D, PARITY) do {                                     \
+    struct tm tm;                                                         \
+    memset(&tm, 0, sizeof(tm));                                           \
+    int64_t days = tz_days_from_civil(Y, M, D);                           \
+    tm.tm_year = Y - 1900;                                                \
+    tm.tm_mon = M - 1;                                                    \
+    tm.tm_mday = D;                                                       \
+    tm.tm_wday = (int)((days % 7 + 7 + 4) % 7);                           \
+    if (PARITY != biweek_parity(YEAR, &tm)) TFAILF(" %d-%d-%d", Y, M, D); \
+  } while_0
+  /* 2015-01-01 was a Thursday, so its first week began 2014-12-28. */
+  X(2015, 2014, 12, 28, 0);
+  X(2015, 2015,  1,  3, 0);
+  X(2015, 2015,  1,  4, 1);
+  X(2015, 2015,  1, 11, 0);
+  X(2015, 2014, 12, 27, 1);
+  X(2015, 2016,  1,  1, 0);  /* 52 weeks later */
+  X(2016, 2016,  1,  1, 0);
+  X(1970, 1970,  1,  1, 0);
+  X(1970, 1969, 12, 27, 1);
+#undef X
+  if (biweek_first_sunday(2015) != tz_days_from_civil(2014, 12, 28)) TFAIL();
+  if (biweek_first_sunday(2017) != tz_days_from_civil(2017, 1, 1)) TFAIL();
+}
+
+static void test_biweek_remaining(void)
+{
+#define X(HRSSS, TIME, IS_IN, SECONDS) do {                        \
+    a_hrs3 hrs3;                                                   \
+    a_time t;                                                      \
+    if (OK != hrs3_init(&hrs3, HRSSS, strlen(HRSSS))) TFAIL();     \
+    if (OK != time_parse(&t, TIME, strlen(TIME))) TFAIL();         \
+    a_remaining_result result = hrs3_remaining(&hrs3, &t);         \
+    if (!result.is_valid || IS_IN != result.time_is_in_schedule || \
+        SECONDS != result.seconds)                                 \
+      TFAILF(" %s %s %d %d", HRSSS, TIME,                          \
+             result.time_is_in_schedule, result.seconds);          \
+    hrs3_destroy(&hrs3);                                           \
+  } while_0
+  /* The week of 2015-01-04 is the second half, and of 2015-01-11 the first. */
+  X("B2015M8-12|T8-12", "20150105090000", 0, 23 * 3600);
+  X("B2015M8-12|T8-12", "20150106090000", 1, 3 * 3600);
+  X("B2015M8-12|T8-12", "20150106120000", 0, 5 * 24 * 3600 + 20 * 3600);
+  X("B2015M8-12|T8-12", "20150112090000", 1, 3 * 3600);
+  X("B2015M8-12|T8-12", "20150113090000", 0, 6 * 24 * 3600 + 23 * 3600);
+  X("B2015M8-12", "20150105090000", 0, 7 * 24 * 3600 - 3600);
+#undef X
+}
+
+PRE_INIT(test_biweekly)
+{
+  test_biweek_init();
+  test_biweek_parity();
+  test_biweek_remaining();
+}
+#endif
+
+#if ONE_OBJ
+#include "weekly.c"
+#include "tz.c"
+#include "../hrs3.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o biweekly biweekly.c && ./biweekly"
+ * End:
+ */
+
+#endif /* __biweekly_c__ */
@@ -0,0 +1,29 @@
+#ifndef __biweekly_h__
+#define __biweekly_h__
+
+#include "weekly.h"
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * biweekly - Two weeks that alternate, such as "B2015M8-12|T8-12".
+ * Weeks start on Sunday, and the week that has January 1st of the
+ * anchor year uses the first half, the week after it the second half,
+ * and so on in both directions.  A missing second half is a week
+ * without shifts.
+ */
+
+#define BIWEEK_DEFAULT_YEAR 1970
+
+typedef struct a_biweek {
+  int year;
+  a_week weeks[2];
+} a_biweek;
+
+status biweek_init(a_biweek *biweek, const char *s, size_t len);
+void biweek_destroy(a_biweek *biweek);
+int64_t biweek_first_sunday(int year);
+int biweek_parity(int year, const struct tm *tm);
+void biweek_add_to_schedule(const a_biweek *biweek, const a_time *t, struct a_schedule *schedule);
+
+#endif /* __biweekly_h__ */
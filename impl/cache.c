@@ -0,0 +1,333 @@
+#ifndef __cache_c__
+#define __cache_c__
+
+#include "impl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static a_cache_entry **cache_bucket(a_cache *cache, uint64_t hash)
+{
+  return &cache->buckets[hash & (cache->n_buckets - 1)];
+}
+
+/* Whether what entry holds depends on the zone it was parsed in */
+static bool cache_entry_is_zoned(const a_cache_entry *entry)
+{
+  return !entry->is_valid || Raw == entry->compiled.hrs3.kind;
+}
+
+static a_cache_entry *cache_find(a_cache *cache, const char *key, size_t len, uint64_t hash,
+                                 const a_tz *tz)
+{
+  if (!cache->n_buckets)
+    return 0;
+  a_cache_entry *entry = *cache_bucket(cache, hash);
+  for (; entry; entry = entry->next) {
+    if (hash == entry->hash && (!cache_entry_is_zoned(entry) || tz == entry->tz) &&
+        len == entry->key_len && 0 == memcmp(entry->key, key, len))
+      return entry;
+  }
+  return 0;
+}
+
+static void cache_unlink_lru(a_cache *cache, a_cache_entry *entry)
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    cache->newest = entry->older;
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+  entry->newer = 0;
+  entry->older = 0;
+}
+
+static void cache_link_newest(a_cache *cache, a_cache_entry *entry)
+{
+  entry->older = cache->newest;
+  entry->newer = 0;
+  if (cache->newest)
+    cache->newest->newer = entry;
+  cache->newest = entry;
+  if (!cache->oldest)
+    cache->oldest = entry;
+}
+
+static void cache_entry_free(a_cache_entry *entry)
+{
+  compiled_destroy(&entry->compiled);
+  free(entry->key);
+  free(entry);
+}
+
+static void cache_evict(a_cache *cache, a_cache_entry *entry)
+{
+  a_cache_entry **it = cache_bucket(cache, entry->hash);
+  for (; *it; it = &(*it)->next) {
+    if (*it == entry) {
+      *it = entry->next;
+      break;
+    }
+  }
+  cache_unlink_lru(cache, entry);
+  cache->size -= 1;
+  entry->evicted = true;
+  if (0 == entry->refs)
+    cache_entry_free(entry);
+}
+
+static void cache_shrink(a_cache *cache)
+{
+  while (cache->capacity < cache->size) {
+    cache_evict(cache, cache->oldest);
+    cache->evictions += 1;
+  }
+}
+
+static void cache_rehash(a_cache *cache, size_t n_buckets)
+{
+  a_cache_entry **buckets = calloc(n_buckets, sizeof(a_cache_entry *));
+  if (!buckets)
+    return; /* the chains just get longer */
+  a_cache_entry **old = cache->buckets;
+  size_t n_old = cache->n_buckets;
+  cache->buckets = buckets;
+  cache->n_buckets = n_buckets;
+  size_t i = 0;
+  for (; i < n_old; ++i) {
+    a_cache_entry *entry = old[i];
+    while (entry) {
+      a_cache_entry *next = entry->next;
+      a_cache_entry **bucket = cache_bucket(cache, entry->hash);
+      entry->next = *bucket;
+      *bucket = entry;
+      entry = next;
+    }
+  }
+  if (old)
+    free(old);
+}
+
+void cache_set_capacity(a_cache *cache, size_t capacity)
+{
+  MUTEX_LOCK(&cache->mutex);
+  cache->capacity = capacity;
+  cache_shrink(cache);
+  if (capacity) {
+    size_t n_buckets = 16;
+    while (n_buckets < capacity)
+      n_buckets *= 2;
+    if (n_buckets != cache->n_buckets)
+      cache_rehash(cache, n_buckets);
+  } else if (cache->buckets) {
+    free(cache->buckets);
+    cache->buckets = 0;
+    cache->n_buckets = 0;
+  }
+  ATOMIC_STORE(&cache->enabled, capacity ? 1 : 0);
+  MUTEX_UNLOCK(&cache->mutex);
+}
+
+static const a_cache_entry *cache_lookup(a_cache *cache, const char *key, size_t len,
+                                         uint64_t hash, const a_tz *tz)
+{
+  a_cache_entry *entry = cache_find(cache, key, len, hash, tz);
+  if (!entry)
+    return 0;
+  cache_unlink_lru(cache, entry);
+  cache_link_newest(cache, entry);
+  entry->refs += 1;
+  cache->hits += 1;
+  return entry;
+}
+
+/*
+ * cache_peek returns the entry for key if it is already cached in the
+ * zone of tz_local, without compiling it on a miss.  Pass a non-null
+ * result to cache_release.
+ */
+const a_cache_entry *cache_peek(a_cache *cache, const char *key, size_t len)
+{
+  if (!ATOMIC_LOAD(&cache->enabled))
+    return 0;
+  uint64_t hash = hash_bytes(key, len);
+  const a_tz *tz = tz_local();
+  MUTEX_LOCK(&cache->mutex);
+  const a_cache_entry *entry = cache_lookup(cache, key, len, hash, tz);
+  MUTEX_UNLOCK(&cache->mutex);
+  return entry;
+}
+
+/*
+ * cache_acquire returns the entry for key in the zone of tz_local,
+ * compiling and inserting it on a miss.  If key doesn't compile, the
+ * entry is not is_valid.  It returns null if the cache is disabled or
+ * there's no memory.  Pass a non-null result to cache_release.
+ */
+const a_cache_entry *cache_acquire(a_cache *cache, const char *key, size_t len)
+{
+  if (!ATOMIC_LOAD(&cache->enabled))
+    return 0;
+  uint64_t hash = hash_bytes(key, len);
+  const a_tz *tz = tz_local();
+  MUTEX_LOCK(&cache->mutex);
+  const a_cache_entry *found = cache_lookup(cache, key, len, hash, tz);
+  if (!found)
+    cache->misses += 1;
+  MUTEX_UNLOCK(&cache->mutex);
+  if (found)
+    return found;
+
+  /* Compile outside of the lock, since that is the slow part. */
+  a_cache_entry *entry = calloc(1, sizeof(a_cache_entry));
+  if (!entry)
+    return 0;
+  entry->key = malloc(len + 1);
+  if (!entry->key) {
+    free(entry);
+    return 0;
+  }
+  entry->is_valid = OK == compiled_init(&entry->compiled, key, len) ? true : false;
+  if (!entry->is_valid)
+    memset(&entry->compiled, 0, sizeof(a_compiled));
+  entry->hash = hash;
+  entry->tz = tz;
+  entry->refs = 1;
+  memcpy(entry->key, key, len);
+  entry->key[len] = 0;
+  entry->key_len = len;
+
+  MUTEX_LOCK(&cache->mutex);
+  if (!cache->capacity || !cache->n_buckets) {
+    /* disabled meanwhile, or never got buckets */
+    entry->evicted = true;
+  } else if ((found = cache_find(cache, key, len, hash, tz))) {
+    /* another thread inserted it meanwhile */
+    entry->evicted = true;
+  } else {
+    a_cache_entry **bucket = cache_bucket(cache, hash);
+    entry->next = *bucket;
+    *bucket = entry;
+    cache_link_newest(cache, entry);
+    cache->size += 1;
+    cache_shrink(cache);
+  }
+  MUTEX_UNLOCK(&cache->mutex);
+  return entry;
+}
+
+void cache_release(a_cache *cache, const a_cache_entry *entry_in)
+{
+  a_cache_entry *entry = (a_cache_entry *)entry_in;
+  MUTEX_LOCK(&cache->mutex);
+  entry->refs -= 1;
+  bool is_garbage = entry->evicted && 0 == entry->refs;
+  MUTEX_UNLOCK(&cache->mutex);
+  if (is_garbage)
+    cache_entry_free(entry);
+}
+
+#if RUN_TESTS
+static void test_cache_lru(void)
+{
+  a_cache cache_ = CACHE_INITIALIZER, *cache = &cache_;
+  const a_cache_entry *entry;
+#define ACQUIRE(S, HITS, MISSES, EVICTIONS, SIZE) do {                  \
+    entry = cache_acquire(cache, S, sizeof(S) - 1);                     \
+    if (!entry) TFAIL();                                                \
+    if (strcmp(entry->key, S)) TFAIL();                                 \
+    cache_release(cache, entry);                                        \
+    if (HITS != cache->hits) TFAILF(" hits %lu", cache->hits);          \
+    if (MISSES != cache->misses) TFAILF(" misses %lu", cache->misses);  \
+    if (EVICTIONS != cache->evictions) TFAIL();                         \
+    if (SIZE != cache->size) TFAIL();                                   \
+  } while_0
+  if (cache_acquire(cache, "8-9", 3)) TFAIL(); /* disabled */
+  cache_set_capacity(cache, 2);
+  ACQUIRE("8-9",    0, 1, 0, 1);
+  ACQUIRE("8-9",    1, 1, 0, 1);
+  ACQUIRE("U9-10",  1, 2, 0, 2);
+  ACQUIRE("8-9",    2, 2, 0, 2);
+  ACQUIRE("10-11",  2, 3, 1, 2); /* evicts U9-10 */
+  ACQUIRE("8-9",    3, 3, 1, 2);
+  ACQUIRE("U9-10",  3, 4, 2, 2); /* evicts 10-11 */
+#undef ACQUIRE
+  /* a string that doesn't compile is cached as invalid */
+  entry = cache_acquire(cache, "abc", 3);
+  if (!entry || entry->is_valid) TFAIL();
+  cache_release(cache, entry);
+  entry = cache_acquire(cache, "abc", 3);
+  if (!entry || entry->is_valid) TFAIL();
+  cache_release(cache, entry);
+  if (4 != cache->hits || 5 != cache->misses) TFAIL();
+  if (2 != cache->size) TFAIL();
+  if (cache_peek(cache, "11-12", 5)) TFAIL();
+  if (2 != cache->size) TFAIL();
+
+  /* An entry stays usable after it is evicted, until it is released. */
+  entry = cache_acquire(cache, "8-9", 3);
+  cache_set_capacity(cache, 0);
+  if (cache->size || cache->newest || cache->oldest) TFAIL();
+  if (!entry->evicted) TFAIL();
+  if (Daily != entry->compiled.hrs3.kind) TFAIL();
+  cache_release(cache, entry);
+  if (cache_acquire(cache, "8-9", 3)) TFAIL();
+
+  /*
+   * Keys are compared by length, so a null doesn't end one early,
+   * even where hashes collide.
+   */
+  cache_set_capacity(cache, 2);
+  entry = cache_acquire(cache, "8-9\0" "10", 6);
+  if (!entry || 6 != entry->key_len) TFAIL();
+  if (cache_find(cache, "8-9", 3, entry->hash, entry->tz)) TFAIL();
+  if (entry != cache_find(cache, "8-9\0" "10", 6, entry->hash, entry->tz)) TFAIL();
+  cache_release(cache, entry);
+  cache_set_capacity(cache, 0);
+}
+
+/* Raw times are cached once per zone, and other schedules once. */
+static void test_cache_zones(void)
+{
+  const a_tz *utc = tz_get_zone("UTC"), *tokyo = tz_get_zone("Asia/Tokyo");
+  if (!utc || !tokyo)
+    return; /* no zoneinfo */
+  a_cache cache_ = CACHE_INITIALIZER, *cache = &cache_;
+  cache_set_capacity(cache, 4);
+  static const char raw[] = "20151016090000-20151016100000";
+  const a_tz *was = tz_set_local(utc);
+  cache_release(cache, cache_acquire(cache, raw, sizeof(raw) - 1));
+  cache_release(cache, cache_acquire(cache, "8-9", 3));
+  tz_set_local(tokyo);
+  const a_cache_entry *entry = cache_acquire(cache, raw, sizeof(raw) - 1);
+  if (!entry || tokyo != entry->tz) TFAIL();
+  cache_release(cache, entry);
+  cache_release(cache, cache_acquire(cache, "8-9", 3));
+  cache_release(cache, cache_acquire(cache, raw, sizeof(raw) - 1));
+  if (2 != cache->hits || 3 != cache->misses || 3 != cache->size)
+    TFAILF(" %lu %lu %lu", cache->hits, cache->misses, (unsigned long)cache->size);
+  tz_set_local(was);
+  cache_set_capacity(cache, 0);
+}
+
+PRE_INIT(test_cache)
+{
+  test_cache_lru();
+  test_cache_zones();
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "compiled.c"
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o cache cache.c && ./cache"
+ * End:
+ */
+
+#endif /* __cache_c__ */
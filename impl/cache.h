@@ -0,0 +1,55 @@
+#ifndef __cache_h__
+#define __cache_h__
+
+#include "compiled.h"
+#include "os.h"
+#include <stdint.h>
+
+/*
+ * cache - A bounded, thread-safe, least-recently-used map from
+ * normalized hrs3 strings to compiled schedules.
+ *
+ * Entries are reference counted so that a schedule can be evaluated
+ * outside of the lock, even if another thread evicts it meanwhile.
+ * Strings that don't compile are cached too, as invalid entries, so
+ * that bad input isn't parsed again on every call.  Raw times and
+ * strings that failed are specific to the zone they were parsed in,
+ * and are keyed by it as well.
+ */
+
+typedef struct a_cache_entry {
+  struct a_cache_entry *next;  /* next entry in the same bucket */
+  struct a_cache_entry *newer; /* toward the most recently used */
+  struct a_cache_entry *older; /* toward the least recently used */
+  uint64_t hash;
+  int refs;
+  bool evicted;
+  bool is_valid;         /* false if key doesn't compile */
+  char *key;
+  size_t key_len;        /* which may hold nulls */
+  const struct a_tz *tz; /* the zone it was parsed in */
+  a_compiled compiled;
+} a_cache_entry;
+
+typedef struct a_cache {
+  a_mutex mutex;
+  long enabled;       /* read without the lock, see ATOMIC_LOAD */
+  size_t capacity;
+  size_t size;
+  size_t n_buckets;
+  a_cache_entry **buckets;
+  a_cache_entry *newest;
+  a_cache_entry *oldest;
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+} a_cache;
+
+#define CACHE_INITIALIZER { MUTEX_INITIALIZER }
+
+const a_cache_entry *cache_acquire(a_cache *cache, const char *key, size_t len);
+const a_cache_entry *cache_peek(a_cache *cache, const char *key, size_t len);
+void cache_release(a_cache *cache, const a_cache_entry *entry);
+void cache_set_capacity(a_cache *cache, size_t capacity);
+
+#endif /* __cache_h__ */
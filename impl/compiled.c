@@ -0,0 +1,1470 @@
+#ifndef __compiled_c__
+#define __compiled_c__
+
+#include "impl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void compiled_add_day(a_compiled *compiled, int day_index, const a_day *day)
+{
+  int *transitions = compiled->transitions;
+  int i = 0;
+  for (; i < day->n_ranges; ++i) {
+    const a_military_range *range = &day->ranges[i];
+    int start = 3600 * 24 * day_index + military_time_as_seconds_of_day(&range->start);
+    int stop = 3600 * 24 * day_index + military_time_as_seconds_of_day(&range->stop);
+    int n = compiled->n_transitions;
+    if (n && start <= transitions[n - 1]) {
+      /* abuts at midnight, e.g. M23-24.T0-1 */
+      if (transitions[n - 1] < stop)
+        transitions[n - 1] = stop;
+      continue;
+    }
+    transitions[n] = start;
+    transitions[n + 1] = stop;
+    compiled->n_transitions += 2;
+  }
+}
+
+static status compiled_add_days(a_compiled *compiled, const a_day *const *days, int n_days)
+{
+  int n_ranges = 0;
+  int i = 0;
+  for (; i < n_days; ++i)
+    n_ranges += days[i]->n_ranges;
+  compiled->n_days = n_days;
+  compiled->n_transitions = 0;
+  compiled->transitions = malloc(sizeof(int) * 2 * (n_ranges ? n_ranges : 1));
+  if (!compiled->transitions)
+    return NO;
+  for (i = 0; i < n_days; ++i)
+    compiled_add_day(compiled, i, days[i]);
+  return OK;
+}
+
+static void compiled_finish(a_compiled *compiled)
+{
+  compiled->period_in = 0;
+  int i = 0;
+  for (; i < compiled->n_transitions; i += 2)
+    compiled->period_in += compiled->transitions[i + 1] - compiled->transitions[i];
+  if (2 * COMPILED_BITMAP_MIN_SHIFTS <= compiled->n_transitions)
+    compiled_set_mode(compiled, Bitmap);
+}
+
+void compiled_set_mode(a_compiled *compiled, a_compiled_mode mode)
+{
+  if (mode == compiled->mode || !compiled->n_days)
+    return;
+  if (Bitmap != mode) {
+    compiled->mode = mode;
+    bitmap_destroy(&compiled->bitmap);
+    return;
+  }
+  /* without memory for the bitmap, the transitions do */
+  if (OK != bitmap_init(&compiled->bitmap, 24 * 60 * compiled->n_days))
+    return;
+  compiled->mode = mode;
+  int i = 0;
+  for (; i < compiled->n_transitions; i += 2) {
+    bitmap_set_range(&compiled->bitmap,
+                     compiled->transitions[i] / 60,
+                     compiled->transitions[i + 1] / 60);
+  }
+}
+
+status compiled_init(a_compiled *compiled, const char *s, size_t len)
+{
+  memset(compiled, 0, sizeof(a_compiled));
+  NOD(hrs3_init(&compiled->hrs3, s, len));
+  const a_hrs3 *hrs3 = &compiled->hrs3;
+  const a_day *days[14];
+  int n_days = 0;
+  int i = 0;
+  switch (hrs3->kind) {
+  case Daily:
+    days[n_days++] = &hrs3->day;
+    break;
+  case Weekdaily:
+  case Weekly:
+    for (; i < 7; ++i)
+      days[n_days++] = &hrs3->week.days[i];
+    break;
+  case Biweekly:
+    for (; i < 14; ++i)
+      days[n_days++] = &hrs3->biweek.weeks[i / 7].days[i % 7];
+    break;
+  default:
+    break;
+  }
+  if (n_days && OK != compiled_add_days(compiled, days, n_days)) {
+    compiled_destroy(compiled);
+    return NO;
+  }
+  compiled_finish(compiled);
+  return OK;
+}
+
+static int compiled_upper_bound(const a_compiled *compiled, int offset);
+
+/*
+ * Repeat the transitions of compiled to fill a period of n_days that
+ * starts 'shift' seconds into its own period, which needs at most
+ * n_days / compiled->n_days + 1 times its transitions, plus 2.
+ */
+static int compiled_repeat(const a_compiled *compiled, int n_days, int shift, int *out)
+{
+  int period = 3600 * 24 * n_days;
+  int n = 0;
+  if (!compiled->n_transitions)
+    return 0;
+  if (compiled_upper_bound(compiled, shift) & 1)
+    out[n++] = 0;
+  int base = -shift;
+  for (; base < period; base += 3600 * 24 * compiled->n_days) {
+    int j = 0;
+    for (; j < compiled->n_transitions; ++j) {
+      int t = base + compiled->transitions[j];
+      if (0 < t && t < period)
+        out[n++] = t;
+    }
+  }
+  if (n & 1)
+    out[n++] = period;
+  return n;
+}
+
+static bool compiled_op_apply(a_compiled_op op, bool a, bool b)
+{
+  switch (op) {
+  case Union: return a || b;
+  case Intersection: return a && b;
+  default: return a && !b;
+  }
+}
+
+/*
+ * Walk two transition tables of the same period in order, keeping
+ * whether each is in after all of its transitions at a time, and emit
+ * a transition wherever the combination changes.  So, as with
+ * schedule_insert, runs that overlap or abut become one run.
+ */
+static status compiled_merge(a_compiled *compiled, int n_days, int year, a_compiled_op op,
+                             const int *a, int n_a, const int *b, int n_b)
+{
+  memset(compiled, 0, sizeof(a_compiled));
+  compiled->hrs3.kind = 1 == n_days ? Daily : 7 == n_days ? Weekly : Biweekly;
+  if (14 == n_days)
+    compiled->hrs3.biweek.year = year;
+  compiled->n_days = n_days;
+  compiled->transitions = malloc(sizeof(int) * (n_a + n_b ? n_a + n_b : 1));
+  if (!compiled->transitions)
+    return NO;
+  bool was_in = false;
+  int i = 0, j = 0;
+  while (i < n_a || j < n_b) {
+    int t = j == n_b || (i < n_a && a[i] < b[j]) ? a[i] : b[j];
+    while (i < n_a && a[i] == t)
+      ++i;
+    while (j < n_b && b[j] == t)
+      ++j;
+    bool is_in = compiled_op_apply(op, i & 1, j & 1);
+    if (is_in != was_in) {
+      compiled->transitions[compiled->n_transitions++] = t;
+      was_in = is_in;
+    }
+  }
+  compiled_finish(compiled);
+  return OK;
+}
+
+/* The anchor year of a biweekly schedule, 0 for others. */
+static int compiled_year(const a_compiled *compiled)
+{
+  return 14 == compiled->n_days ? compiled->hrs3.biweek.year : 0;
+}
+
+static int compiled_gcd(int a, int b)
+{
+  while (b) {
+    int r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+/*
+ * Combine two periodic schedules into a new one whose period is a
+ * multiple of both.  Raw and now schedules can't be combined.  A
+ * biweekly result keeps the anchor year of a if it is biweekly, and
+ * b's weeks are swapped if its anchor year has the other parity.
+ */
+status compiled_combine(a_compiled *compiled, const a_compiled *a, const a_compiled *b,
+                        a_compiled_op op)
+{
+  if (!a->n_days || !b->n_days)
+    return NO;
+  int n_days = a->n_days / compiled_gcd(a->n_days, b->n_days) * b->n_days;
+  int year = compiled_year(a) ? compiled_year(a) : compiled_year(b);
+  int shift = 0;
+  if (compiled_year(a) && compiled_year(b) &&
+      ((biweek_first_sunday(compiled_year(b)) - biweek_first_sunday(year)) / 7) & 1)
+    shift = 3600 * 24 * 7;
+  int *transitions = malloc(sizeof(int) * ((n_days / a->n_days + 1) * a->n_transitions +
+                                           (n_days / b->n_days + 1) * b->n_transitions + 4));
+  if (!transitions)
+    return NO;
+  int n_a = compiled_repeat(a, n_days, 0, transitions);
+  int n_b = compiled_repeat(b, n_days, shift, transitions + n_a);
+  status ret = compiled_merge(compiled, n_days, year, op, transitions, n_a, transitions + n_a, n_b);
+  free(transitions);
+  return ret;
+}
+
+status compiled_complement(a_compiled *compiled, const a_compiled *a)
+{
+  if (!a->n_days)
+    return NO;
+  int whole[2] = { 0, 3600 * 24 * a->n_days };
+  return compiled_merge(compiled, a->n_days, compiled_year(a), Difference,
+                        whole, 2, a->transitions, a->n_transitions);
+}
+
+/*
+ * The shifts of the day_index'th day of the period, as pairs of
+ * seconds of the day.
+ */
+static int compiled_day_ranges(const a_compiled *compiled, int day_index, int *out)
+{
+  int day_start = 3600 * 24 * day_index;
+  int day_stop = day_start + 3600 * 24;
+  int n = 0;
+  int i = 0;
+  for (; i < compiled->n_transitions; i += 2) {
+    int start = compiled->transitions[i];
+    int stop = compiled->transitions[i + 1];
+    if (stop <= day_start || day_stop <= start)
+      continue;
+    out[n++] = (start < day_start ? day_start : start) - day_start;
+    out[n++] = (day_stop < stop ? day_stop : stop) - day_start;
+  }
+  return n;
+}
+
+/*
+ * Append n characters of s to the string of length len in buf, as
+ * much as fits with a null, and return the length it would have.
+ */
+static int compiled_append(char *buf, size_t size, int len, const char *s, size_t n)
+{
+  size_t i = 0;
+  for (; i < n; ++i, ++len) {
+    if ((size_t)len + 1 < size)
+      buf[len] = s[i];
+  }
+  if (size)
+    buf[(size_t)len < size ? (size_t)len : size - 1] = 0;
+  return len;
+}
+
+static int compiled_format_ranges(char *buf, size_t size, int len, const int *ranges, int n)
+{
+  char buffer[sizeof("&2359-2359")];
+  int i = 0;
+  for (; i < n; i += 2) {
+    a_military_range range;
+    range.start.hour = ranges[i] / 3600;
+    range.start.minute = ranges[i] / 60 % 60;
+    range.stop.hour = ranges[i + 1] / 3600;
+    range.stop.minute = ranges[i + 1] / 60 % 60;
+    size_t offset = 0;
+    if (i)
+      buffer[offset++] = '&';
+    offset += military_range_to_s(&range, &buffer[offset]);
+    len = compiled_append(buf, size, len, buffer, offset);
+  }
+  return len;
+}
+
+/* Whether n days from day a have the same shifts as n days from day b. */
+static bool compiled_same_days(const a_compiled *compiled, int a, int b, int n,
+                               int *ranges, int *other)
+{
+  int i = 0;
+  for (; i < n; ++i) {
+    int n_ranges = compiled_day_ranges(compiled, a + i, ranges);
+    if (n_ranges != compiled_day_ranges(compiled, b + i, other) ||
+        memcmp(ranges, other, sizeof(int) * n_ranges))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Append the week of the period that starts on day first_day as a
+ * weekly schedule.
+ */
+static int compiled_format_week(const a_compiled *compiled, int first_day, int *ranges,
+                                int *other, char *buf, size_t size, int len)
+{
+  static const char letters[] = "UMTWRFA";
+  static const int monday_first[] = { 1, 2, 3, 4, 5, 6, 0 };
+  int start = len;
+  int done = 0; /* bit per day */
+  int i = 0;
+  for (; i < 7; ++i) {
+    int day_index = monday_first[i];
+    if (done & (1 << day_index))
+      continue;
+    int n = compiled_day_ranges(compiled, first_day + day_index, ranges);
+    if (!n)
+      continue;
+    if (len != start)
+      len = compiled_append(buf, size, len, ".", 1);
+    int j = i;
+    for (; j < 7; ++j) {
+      int other_index = monday_first[j];
+      if (j != i && !compiled_same_days(compiled, first_day + day_index,
+                                        first_day + other_index, 1, ranges, other))
+        continue;
+      done |= 1 << other_index;
+      len = compiled_append(buf, size, len, &letters[other_index], 1);
+    }
+    len = compiled_format_ranges(buf, size, len, ranges, n);
+  }
+  return len;
+}
+
+/*
+ * Whether the week has the same shifts Monday through Friday and none
+ * on weekends.
+ */
+static bool compiled_is_weekdaily(const a_compiled *compiled, int *ranges, int *other)
+{
+  return !compiled_day_ranges(compiled, 0, ranges) &&
+    !compiled_day_ranges(compiled, 6, ranges) &&
+    compiled_same_days(compiled, 1, 2, 4, ranges, other);
+}
+
+/* Whether the week of the period that starts on day first_day has no shifts. */
+static bool compiled_week_is_empty(const a_compiled *compiled, int first_day, int *ranges)
+{
+  int i = 0;
+  for (; i < 7; ++i) {
+    if (compiled_day_ranges(compiled, first_day + i, ranges))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Write the schedule as its canonical hrs3 string (see README.md),
+ * like snprintf: return the length of the whole string, of which at
+ * most size - 1 characters and a null are written to buf.  For daily
+ * and weekly schedules, days are ordered Monday first, days with the
+ * same shifts are grouped, and a schedule that is the same every day
+ * is written as daily, and one that is the same Monday through Friday
+ * and never on weekends as weekdaily.  A biweekly schedule whose weeks
+ * are the same is written as weekly, and one whose first week is
+ * empty is anchored to the next year with the other parity instead.
+ * Return 0 if the schedule is never in, which has no hrs3 string, and
+ * -1 if it is invalid or there's no memory.
+ */
+int compiled_format(const a_compiled *compiled, char *buf, size_t size)
+{
+  if (size)
+    *buf = 0;
+  if (Raw == compiled->hrs3.kind) {
+    char buffer[TIME_RANGE_STR_SIZE];
+    size_t n = time_range_to_s(&compiled->hrs3.time_range, buffer);
+    return compiled_append(buf, size, 0, buffer, n);
+  }
+  if (Now == compiled->hrs3.kind) {
+    char buffer[NOW_STR_SIZE];
+    size_t n = now_to_s(&compiled->hrs3.now_range, buffer);
+    return compiled_append(buf, size, 0, buffer, n);
+  }
+  if (!compiled->n_days)
+    return -1;
+  int *ranges = malloc(sizeof(int) * (2 * compiled->n_transitions + 2));
+  if (!ranges)
+    return -1;
+  int *other = ranges + compiled->n_transitions + 1;
+  int len = 0;
+  bool is_daily = true;
+  int i = 1;
+  for (; is_daily && i < compiled->n_days; ++i)
+    is_daily = compiled_same_days(compiled, 0, i, 1, ranges, other);
+  if (is_daily) {
+    int n = compiled_day_ranges(compiled, 0, ranges);
+    len = compiled_format_ranges(buf, size, len, ranges, n);
+  } else if (compiled_is_weekdaily(compiled, ranges, other) &&
+             (7 == compiled->n_days || compiled_same_days(compiled, 0, 7, 7, ranges, other))) {
+    int n = compiled_day_ranges(compiled, 1, ranges);
+    len = compiled_append(buf, size, len, "P", 1);
+    len = compiled_format_ranges(buf, size, len, ranges, n);
+  } else if (7 == compiled->n_days || compiled_same_days(compiled, 0, 7, 7, ranges, other)) {
+    len = compiled_format_week(compiled, 0, ranges, other, buf, size, len);
+  } else {
+    int year = compiled->hrs3.biweek.year;
+    int first_day = 0;
+    if (compiled_week_is_empty(compiled, 0, ranges)) {
+      int64_t first_sunday = biweek_first_sunday(year);
+      while (!(((biweek_first_sunday(++year) - first_sunday) / 7) & 1))
+        ;
+      first_day = 7;
+    }
+    char buffer[sizeof("B2147483647")];
+    len = compiled_append(buf, size, len, buffer, sprintf(buffer, "B%d", year));
+    len = compiled_format_week(compiled, first_day, ranges, other, buf, size, len);
+    if (!compiled_week_is_empty(compiled, 7 - first_day, ranges)) {
+      len = compiled_append(buf, size, len, "|", 1);
+      len = compiled_format_week(compiled, 7 - first_day, ranges, other, buf, size, len);
+    }
+  }
+  free(ranges);
+  return len;
+}
+
+void compiled_destroy(a_compiled *compiled)
+{
+  if (compiled->transitions)
+    free(compiled->transitions);
+  bitmap_destroy(&compiled->bitmap);
+  hrs3_destroy(&compiled->hrs3);
+  compiled->mode = Transitions;
+  compiled->n_days = 0;
+  compiled->n_transitions = 0;
+  compiled->transitions = 0;
+}
+
+/*
+ * Find the time 'offset' seconds into the period whose 'day_index'th
+ * day is the date of t.  Times that occur twice because of DST
+ * resolve to the one nearest to t that is at least as large as t,
+ * just like time_ymdhms.
+ */
+static bool compiled_resolve(const a_time *t, int day_index, int offset, a_time *out)
+{
+  const struct tm *tm = time_tm(t);
+  int year = tm->tm_year + 1900;
+  int mon = tm->tm_mon + 1;
+  int mday = tm->tm_mday;
+  int seconds = offset % (3600 * 24);
+  date_incr(&year, &mon, &mday, offset / (3600 * 24) - day_index);
+  time_copy(out, t);
+  return time_ymdhms(out, year, mon, mday,
+                     seconds / 3600, seconds / 60 % 60, seconds % 60);
+}
+
+/*
+ * Which day of the period the date of tm is: the weekday for weekly
+ * schedules, and for biweekly ones a week later in odd weeks.
+ */
+static int compiled_day_index(const a_compiled *compiled, const struct tm *tm)
+{
+  switch (compiled->n_days) {
+  case 1: return 0;
+  case 7: return tm->tm_wday;
+  default: return 7 * biweek_parity(compiled->hrs3.biweek.year, tm) + tm->tm_wday;
+  }
+}
+
+/*
+ * Return the index of the first transition after 'offset', or
+ * n_transitions if there is none.  The loop has no data-dependent
+ * branches, only a conditional move.
+ */
+static int compiled_upper_bound(const a_compiled *compiled, int offset)
+{
+  const int *base = compiled->transitions;
+  int n = compiled->n_transitions;
+  while (1 < n) {
+    int half = n / 2;
+    base = base[half] <= offset ? base + half : base;
+    n -= half;
+  }
+  return (int)(base - compiled->transitions) + (*base <= offset);
+}
+
+/*
+ * Whether a shift lasts until the end of the period and another
+ * starts it.  A schedule that is always in is in until the end of the
+ * period.
+ */
+static bool compiled_carries_on(const a_compiled *compiled)
+{
+  int n = compiled->n_transitions;
+  return 2 < n && 0 == compiled->transitions[0] &&
+    3600 * 24 * compiled->n_days == compiled->transitions[n - 1];
+}
+
+/*
+ * Return the offset of the first boundary after 'offset', and whether
+ * offset is in the schedule.  If offset follows every transition, the
+ * next boundary is the first transition of the next period, which is
+ * the case hrs3_remaining handles by looking ahead to the next day or
+ * week.  Likewise a shift that lasts until the end of the period
+ * carries on into one that starts the next period.
+ */
+static int compiled_boundary_transitions(const a_compiled *compiled, int offset, bool *is_in)
+{
+  const int *transitions = compiled->transitions;
+  int n = compiled->n_transitions;
+  int i = compiled_upper_bound(compiled, offset);
+  *is_in = i & 1;
+  if (i == n - 1 && compiled_carries_on(compiled))
+    return transitions[i] + transitions[1];
+  if (i < n)
+    return transitions[i];
+  return transitions[0] + 3600 * 24 * compiled->n_days;
+}
+
+static int compiled_boundary_bitmap(const a_compiled *compiled, int offset, bool *is_in)
+{
+  const a_bitmap *bitmap = &compiled->bitmap;
+  int minute = offset / 60;
+  *is_in = bitmap_test(bitmap, minute);
+  int next = bitmap_find(bitmap, minute + 1, !*is_in);
+  if (0 <= next)
+    return 60 * next;
+  if (*is_in && !bitmap_test(bitmap, 0))
+    return 60 * bitmap->n_bits;
+  next = bitmap_find(bitmap, 0, !*is_in);
+  return 60 * (bitmap->n_bits + (0 <= next ? next : 0));
+}
+
+/* Whether the UTC offset in tz is the same from 'from' through 'to'. */
+static bool compiled_is_uniform(const a_tz *tz, time_t from, time_t to)
+{
+  if (tz)
+    return to < tz_next_transition(tz, from);
+  struct tm a, b;
+  tz_localtime(0, from, &a);
+  tz_localtime(0, to, &b);
+  return a.tm_isdst == b.tm_isdst;
+}
+
+/*
+ * hrs3_remaining of the shifts of compiled.  Where the UTC offset
+ * changes, skipped and repeated times resolve shift by shift, as
+ * military_range_to_time_range does, so that is left to the same
+ * code.  Combined schedules have no days of their own, so the days
+ * are rebuilt from the transitions.
+ */
+static a_remaining_result compiled_remaining_days(const a_compiled *compiled, const a_time *t)
+{
+  uint64_t words[2 * DAY_MINUTES_WORDS];
+  a_bitmap minutes;
+  day_minutes_init(&minutes, words, compiled->n_days);
+  int i = 0;
+  for (; i < compiled->n_transitions; i += 2)
+    bitmap_set_range(&minutes, compiled->transitions[i] / 60, compiled->transitions[i + 1] / 60);
+  a_day days[14];
+  a_military_range *ranges = day_from_minutes(days, compiled->n_days, &minutes);
+  if (!ranges)
+    return remaining_invalid();
+  a_hrs3 hrs3;
+  memset(&hrs3, 0, sizeof(a_hrs3));
+  switch (compiled->n_days) {
+  case 1:
+    hrs3.kind = Daily;
+    hrs3.day = days[0];
+    break;
+  case 7:
+    hrs3.kind = Weekly;
+    memcpy(hrs3.week.days, days, sizeof(hrs3.week.days));
+    break;
+  default:
+    hrs3.kind = Biweekly;
+    hrs3.biweek.year = compiled->hrs3.biweek.year;
+    memcpy(hrs3.biweek.weeks[0].days, days, sizeof(hrs3.biweek.weeks[0].days));
+    memcpy(hrs3.biweek.weeks[1].days, days + 7, sizeof(hrs3.biweek.weeks[1].days));
+    break;
+  }
+  a_remaining_result result = hrs3_remaining(&hrs3, t);
+  arena_free(ranges);
+  return result;
+}
+
+/*
+ * Locate t within the period by its wall-clock time, then measure the
+ * distance to the next boundary.  That is a subtraction while the UTC
+ * offset stays the same from a day before the start of the period to
+ * a day after the boundary, which is as near as a change can be and
+ * still move a time that the shifts resolve to.  Otherwise the shifts
+ * are resolved one by one.
+ */
+static a_remaining_result compiled_remaining_periodic(const a_compiled *compiled, const a_time *t)
+{
+  if (0 == compiled->n_transitions)
+    return remaining_result(false, 0);
+  const struct tm *tm = time_tm(t);
+  int day_index = compiled_day_index(compiled, tm);
+  int second = tm->tm_sec < 60 ? tm->tm_sec : 59; /* leap second */
+  int offset = 3600 * 24 * day_index + 3600 * tm->tm_hour + 60 * tm->tm_min + second;
+  bool is_in = false;
+  int boundary = Bitmap == compiled->mode
+    ? compiled_boundary_bitmap(compiled, offset, &is_in)
+    : compiled_boundary_transitions(compiled, offset, &is_in);
+  time_t start = time_time(t) - offset;
+  if (!compiled_is_uniform(t->tz, start - 3600 * 24, start + boundary + 3600 * 24))
+    return compiled_remaining_days(compiled, t);
+  return remaining_result(is_in, boundary - offset);
+}
+
+a_remaining_result compiled_remaining(const a_compiled *compiled, const a_time *t)
+{
+  switch (compiled->hrs3.kind) {
+  case Daily:
+  case Weekdaily:
+  case Weekly:
+  case Biweekly:
+    return compiled_remaining_periodic(compiled, t);
+  case Raw:
+    return time_range_remaining(&compiled->hrs3.time_range, t);
+  case Now: {
+    a_time_range range;
+    now_to_time_range(&compiled->hrs3.now_range, t, &range);
+    return time_range_remaining(&range, t);
+  }
+  default:
+    return remaining_invalid();
+  }
+}
+
+void compiled_instant_init(a_compiled_instant *instant, time_t time, const a_tz *tz)
+{
+  memset(instant, 0, sizeof(a_compiled_instant));
+  time_init_tz(&instant->t, time, tz);
+  time_tm(&instant->t);
+}
+
+static void compiled_anchor_locate(a_compiled_anchor *anchor, const a_time *t, int n_days)
+{
+  const struct tm *tm = time_tm(t);
+  int day_index = 1 == n_days ? 0 : tm->tm_wday;
+  int offset = 3600 * 24 * day_index + 3600 * tm->tm_hour + 60 * tm->tm_min + tm->tm_sec;
+  anchor->is_located = true;
+  anchor->start = time_time(t) - offset;
+  anchor->is_uniform = compiled_is_uniform(t->tz, anchor->start - 3600 * 24,
+                                           anchor->start + (2 * n_days + 1) * 3600 * 24);
+}
+
+/*
+ * compiled_instant_remaining is compiled_remaining at instant->t,
+ * without converting between local and unix time if possible.
+ */
+a_remaining_result compiled_instant_remaining(const a_compiled *compiled,
+                                              a_compiled_instant *instant)
+{
+  const a_time *t = &instant->t;
+  if (!compiled->n_days || !compiled->n_transitions || !t->tz)
+    return compiled_remaining(compiled, t);
+  a_compiled_anchor *anchor = 1 == compiled->n_days ? &instant->day
+    : 7 == compiled->n_days ? &instant->week : &instant->biweek;
+  if (!anchor->is_located)
+    compiled_anchor_locate(anchor, t, compiled->n_days);
+  if (!anchor->is_uniform)
+    return compiled_remaining(compiled, t);
+  int offset = (int)(time_time(t) - anchor->start);
+  if (14 == compiled->n_days)
+    offset += 3600 * 24 * 7 * biweek_parity(compiled->hrs3.biweek.year, time_tm(t));
+  bool is_in = false;
+  int boundary = Bitmap == compiled->mode
+    ? compiled_boundary_bitmap(compiled, offset, &is_in)
+    : compiled_boundary_transitions(compiled, offset, &is_in);
+  return remaining_result(is_in, boundary - offset);
+}
+
+void compiled_sweep_init(a_compiled_sweep *sweep)
+{
+  memset(sweep, 0, sizeof(a_compiled_sweep));
+}
+
+static void compiled_sweep_locate(const a_compiled *compiled, a_compiled_sweep *sweep,
+                                  const a_time *t)
+{
+  const struct tm *tm = time_tm(t);
+  int day_index = compiled_day_index(compiled, tm);
+  int offset = 3600 * 24 * day_index + 3600 * tm->tm_hour + 60 * tm->tm_min + tm->tm_sec;
+  sweep->start = time_time(t) - offset;
+  sweep->stop = sweep->start + 3600 * 24 * compiled->n_days;
+  /* start is only midnight if the offset didn't change since */
+  sweep->is_uniform =
+    compiled_is_uniform(t->tz, sweep->start - 3600 * 24, sweep->stop + 3600 * 24);
+  sweep->offset = 0;
+  sweep->next = 0;
+  sweep->wrap = 0;
+}
+
+/*
+ * compiled_sweep_remaining is compiled_remaining, except that it
+ * reuses the period located for an earlier time.  A boundary in the
+ * next period is found the usual way, once per period.
+ */
+a_remaining_result compiled_sweep_remaining(const a_compiled *compiled, a_compiled_sweep *sweep,
+                                            const a_time *t)
+{
+  if (!compiled->n_days || !compiled->n_transitions || !t->tz)
+    return compiled_remaining(compiled, t);
+  time_t time = time_time(t);
+  if (time < sweep->start || sweep->stop <= time)
+    compiled_sweep_locate(compiled, sweep, t);
+  if (!sweep->is_uniform)
+    return compiled_remaining(compiled, t);
+  int offset = (int)(time - sweep->start);
+  if (offset < sweep->offset)
+    sweep->next = compiled_upper_bound(compiled, offset);
+  sweep->offset = offset;
+  const int *transitions = compiled->transitions;
+  int n = compiled->n_transitions;
+  while (sweep->next < n && transitions[sweep->next] <= offset)
+    sweep->next += 1;
+  bool carries_on = sweep->next == n - 1 && compiled_carries_on(compiled);
+  if (sweep->next < n && !carries_on)
+    return remaining_result(sweep->next & 1, transitions[sweep->next] - offset);
+  if (carries_on)
+    return compiled_remaining(compiled, t);
+  if (sweep->wrap)
+    return remaining_result(false, (int)(sweep->wrap - time));
+  a_remaining_result result = compiled_remaining(compiled, t);
+  if (result.is_valid)
+    sweep->wrap = time + result.seconds;
+  return result;
+}
+
+void compiled_cursor_init(a_compiled_cursor *cursor, const a_compiled *compiled,
+                          const a_tz *tz)
+{
+  memset(cursor, 0, sizeof(a_compiled_cursor));
+  cursor->compiled = compiled;
+  cursor->tz = tz;
+  compiled_sweep_init(&cursor->sweep);
+}
+
+/*
+ * compiled_cursor_remaining is compiled_remaining at time, which is
+ * only a comparison while time stays in the interval of the previous
+ * call.  Past it, the sweep carries on from the previous time, and
+ * before it or in another period, the time is located afresh.  Now
+ * schedules move with the time, so they have no interval.
+ */
+a_remaining_result compiled_cursor_remaining(a_compiled_cursor *cursor, time_t time)
+{
+  if (cursor->from <= time && time < cursor->boundary)
+    return remaining_result(cursor->is_in, (int)(cursor->boundary - time));
+  a_time t;
+  time_init_tz(&t, time, cursor->tz);
+  if (Now == cursor->compiled->hrs3.kind)
+    return compiled_remaining(cursor->compiled, &t);
+  a_remaining_result result = compiled_sweep_remaining(cursor->compiled, &cursor->sweep, &t);
+  cursor->from = time;
+  cursor->boundary = result.is_valid && result.seconds ? time + result.seconds : 0;
+  cursor->is_in = result.time_is_in_schedule;
+  return result;
+}
+
+void compiled_intervals_init(a_compiled_intervals *intervals, const a_compiled *compiled,
+                             const a_tz *tz, time_t begin, time_t end, bool is_in)
+{
+  memset(intervals, 0, sizeof(a_compiled_intervals));
+  intervals->compiled = compiled;
+  intervals->tz = tz;
+  intervals->is_in = is_in;
+  intervals->next = begin;
+  intervals->end = end;
+  compiled_sweep_init(&intervals->sweep);
+  if (Now == compiled->hrs3.kind) {
+    a_time t;
+    time_init_tz(&t, begin, tz);
+    now_to_time_range(&compiled->hrs3.now_range, &t, &intervals->now_range);
+  }
+}
+
+static a_remaining_result compiled_intervals_remaining(a_compiled_intervals *intervals,
+                                                       time_t time)
+{
+  a_time t;
+  time_init_tz(&t, time, intervals->tz);
+  if (Now == intervals->compiled->hrs3.kind)
+    return time_range_remaining(&intervals->now_range, &t);
+  return compiled_sweep_remaining(intervals->compiled, &intervals->sweep, &t);
+}
+
+/*
+ * Find the next run, clipped to the window.  Return false if there
+ * are no more.
+ */
+bool compiled_intervals_next(a_compiled_intervals *intervals, time_t *start, time_t *stop)
+{
+  time_t end = intervals->end;
+  while (intervals->next < end) {
+    a_remaining_result result = compiled_intervals_remaining(intervals, intervals->next);
+    if (!result.is_valid)
+      break;
+    if (result.time_is_in_schedule != intervals->is_in) {
+      if (!result.seconds)
+        break; /* never again */
+      intervals->next += result.seconds;
+      continue;
+    }
+    *start = intervals->next;
+    *stop = result.seconds ? *start + result.seconds : end;
+    while (*stop < end) {
+      /* e.g., 23-24 followed by 0-1 */
+      result = compiled_intervals_remaining(intervals, *stop);
+      if (!result.is_valid || result.time_is_in_schedule != intervals->is_in)
+        break;
+      *stop = result.seconds ? *stop + result.seconds : end;
+    }
+    if (end < *stop)
+      *stop = end;
+    intervals->next = *stop;
+    return true;
+  }
+  intervals->next = end;
+  return false;
+}
+
+static int64_t compiled_intervals_time_in(const a_compiled *compiled, const a_tz *tz,
+                                          time_t begin, time_t end)
+{
+  a_compiled_intervals intervals;
+  compiled_intervals_init(&intervals, compiled, tz, begin, end, true);
+  int64_t total = 0;
+  time_t start, stop;
+  while (compiled_intervals_next(&intervals, &start, &stop))
+    total += stop - start;
+  return total;
+}
+
+/*
+ * The number of seconds from begin through end - 1 that are in the
+ * schedule.  Whole periods in a stretch without a change of UTC
+ * offset each count period_in, and the rest, such as weeks with a DST
+ * change and the partial periods at either end, is added up interval
+ * by interval.
+ */
+int64_t compiled_time_in(const a_compiled *compiled, const a_tz *tz, time_t begin, time_t end)
+{
+  if (!compiled->n_days || !compiled->n_transitions || !tz)
+    return compiled_intervals_time_in(compiled, tz, begin, end);
+  int period = 3600 * 24 * compiled->n_days;
+  int64_t total = 0;
+  time_t t = begin;
+  while (t < end) {
+    a_time at, period_start, period_stop;
+    time_init_tz(&at, t, tz);
+    int day_index = compiled_day_index(compiled, time_tm(&at));
+    if (!compiled_resolve(&at, day_index, 0, &period_start) ||
+        !compiled_resolve(&at, day_index, period, &period_stop) ||
+        time_time(&period_stop) <= t) {
+      total += compiled_intervals_time_in(compiled, tz, t, end);
+      break;
+    }
+    time_t stop = time_time(&period_stop);
+    if (t == time_time(&period_start)) {
+      int64_t uniform_until = tz_next_transition(tz, t);
+      int64_t n_periods = ((uniform_until < end ? uniform_until : end) - t) / period;
+      if (n_periods) {
+        total += n_periods * compiled->period_in;
+        t += n_periods * period;
+        continue;
+      }
+    }
+    if (end < stop)
+      stop = end;
+    total += compiled_intervals_time_in(compiled, tz, t, stop);
+    t = stop;
+  }
+  return total;
+}
+
+#if RUN_TESTS
+static void test_compiled_matches_hrs3_remaining(a_compiled_mode mode)
+{
+  static const char *hrsss[] = {
+    "830-12",
+    "830-12&13-14",
+    "0-10",
+    "0-1&23-24",
+    "1-3",
+    "130-230",
+    "U8-9",
+    "UA6-7&8-9",
+    "U1-2&3-4.M6-7&8-9",
+    "M23-24.T0-1",
+    "A23-24.U0-1",
+    "UMTWRFA0-2359",
+    "MTWRFAU0-24",
+    "U1-2.M1-2.T1-2.W1-2.R1-2.F1-2.A1-2&3-4&5-6",
+    "B2015M8-12|T8-12",
+    "B2016UA6-7&8-9|A23-24",
+    "B2015UMTWRFA0-24|A23-24",
+    "BU0-1",
+    "P830-12&13-14",
+  };
+  /* this week, and weeks around the DST changes of 2015 in the US and in Europe */
+  static const char *weeks[] = {
+    "20150301000000",
+    "20150322000000",
+    "20151018000000",
+    "20151025000000",
+  };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    const char *s = hrsss[i];
+    a_compiled compiled;
+    a_hrs3 hrs3;
+    if (OK != compiled_init(&compiled, s, strlen(s))) TFAILF(" %s", s);
+    if (OK != hrs3_init(&hrs3, s, strlen(s))) TFAILF(" %s", s);
+    compiled_set_mode(&compiled, mode);
+    size_t j = 0;
+    for (; j <= DIM(weeks); ++j) {
+      a_time week = beginning_of_week(time_now());
+      if (j && OK != time_parse(&week, weeks[j - 1], strlen(weeks[j - 1]))) TFAIL();
+      int minute = -60 * 24;
+      for (; minute < 60 * 24 * 15; minute += 30) {
+        int delta = -1;
+        for (; delta <= 1; ++delta) {
+          a_time t = time_plus(&week, 60 * minute + delta);
+          a_remaining_result expected = hrs3_remaining(&hrs3, &t);
+          a_remaining_result result = compiled_remaining(&compiled, &t);
+          if (expected.is_valid == result.is_valid &&
+              expected.time_is_in_schedule == result.time_is_in_schedule &&
+              expected.seconds == result.seconds)
+            continue;
+          TFAILF(" %s at %ld: %d %u vs %d %u", s, (long)time_time(&t),
+                 expected.time_is_in_schedule, expected.seconds,
+                 result.time_is_in_schedule, result.seconds);
+        }
+      }
+    }
+    hrs3_destroy(&hrs3);
+    compiled_destroy(&compiled);
+  }
+}
+
+static void test_compiled_raw_and_now(void)
+{
+#define X(S, T, IS_IN, SECS) do {                                          \
+    a_compiled compiled;                                                   \
+    a_time t;                                                              \
+    if (OK != compiled_init(&compiled, S, sizeof(S) - 1)) TFAIL();         \
+    if (OK != time_parse(&t, T, sizeof(T) - 1)) TFAIL();                   \
+    a_remaining_result result = compiled_remaining(&compiled, &t);         \
+    if (!result.is_valid) TFAIL();                                         \
+    if (IS_IN != result.time_is_in_schedule) TFAIL();                      \
+    if (SECS != result.seconds) TFAILF(" %d vs %u", SECS, result.seconds); \
+    compiled_destroy(&compiled);                                           \
+  } while_0
+  X("20150429120000-20150429120001", "20150429120000", 1, 1);
+  X("20150429120000-20150429120001", "20150429120001", 0, 0);
+  X("20150429120000-20150429120001", "20150429115959", 0, 1);
+  X("now+1h", "20150429120000", 1, 3600);
+  X("now+1m1s", "20150429120000", 1, 61);
+#undef X
+#define BAD(S) do {                                                        \
+    a_compiled compiled;                                                   \
+    if (OK == compiled_init(&compiled, S, sizeof(S) - 1)) TFAIL();         \
+  } while_0
+  BAD("");
+  BAD("abc");
+  BAD("U13-12");
+#undef BAD
+}
+
+static void test_compiled_sweep(void)
+{
+  static const char *hrsss[] = {
+    "830-12&13-14",
+    "0-1&23-24",
+    "U8-9",
+    "U1-2&3-4.M6-7&8-9",
+    "A23-24.U0-1",
+    "UMTWRFA0-24",
+    "UMTWRFA0-1&2-3&4-5&6-7&8-9&10-11&12-13&14-15&16-17&18-19&20-21&22-23",
+    "B2015M8-12|T8-12",
+    "B2016U1-2&3-4|A23-24",
+  };
+  /* weeks around the DST changes of 2015 in the US and in Europe */
+  static const char *weeks[] = {
+    "20150301000000",
+    "20150322000000",
+    "20151018000000",
+    "20151025000000",
+  };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    a_compiled compiled;
+    if (OK != compiled_init(&compiled, hrsss[i], strlen(hrsss[i]))) TFAIL();
+    size_t j = 0;
+    for (; j < DIM(weeks); ++j) {
+      a_time begin;
+      if (OK != time_parse(&begin, weeks[j], strlen(weeks[j]))) TFAIL();
+      a_compiled_sweep sweep;
+      compiled_sweep_init(&sweep);
+      int k = 0;
+      for (; k < 2 * 2 * 7 * 24 * 6; ++k) {
+        /* ascending, then descending */
+        int sec = k < 2 * 7 * 24 * 6 ? 599 * k : 599 * (4 * 7 * 24 * 6 - k);
+        a_time t = time_plus(&begin, sec);
+        a_remaining_result expected = compiled_remaining(&compiled, &t);
+        a_remaining_result result = compiled_sweep_remaining(&compiled, &sweep, &t);
+        if (expected.is_valid != result.is_valid ||
+            expected.time_is_in_schedule != result.time_is_in_schedule ||
+            expected.seconds != result.seconds)
+          TFAILF(" %s at %ld: %d %u vs %d %u", hrsss[i], (long)time_time(&t),
+                 expected.time_is_in_schedule, expected.seconds,
+                 result.time_is_in_schedule, result.seconds);
+      }
+    }
+    compiled_destroy(&compiled);
+  }
+}
+
+static void test_compiled_cursor(void)
+{
+  static const char *hrsss[] = {
+    "830-12&13-14",
+    "0-1&23-24",
+    "U1-2&3-4.M6-7&8-9",
+    "UMTWRFA0-24",
+    "B2016U1-2&3-4|A23-24",
+    "now+2h",
+    "20151101013000-20151101020000",
+  };
+  a_time begin;
+  if (OK != time_parse(&begin, "20151025000000", 14)) TFAIL();
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    a_compiled compiled;
+    if (OK != compiled_init(&compiled, hrsss[i], strlen(hrsss[i]))) TFAIL();
+    a_compiled_cursor cursor;
+    compiled_cursor_init(&cursor, &compiled, tz_local());
+    time_t time = time_time(&begin);
+    int k = 0;
+    for (; k < 2 * 7 * 24 * 60; ++k) {
+      /* mostly forward, with a jump back every day and far ahead once */
+      if (k && !(k % (24 * 60)))
+        time -= 3600 * 5;
+      else if (k == 7 * 24 * 60)
+        time += 3600 * 24 * 40;
+      else
+        time += 61;
+      a_time t;
+      time_init_tz(&t, time, tz_local());
+      a_remaining_result expected = compiled_remaining(&compiled, &t);
+      a_remaining_result result = compiled_cursor_remaining(&cursor, time);
+      if (expected.is_valid != result.is_valid ||
+          expected.time_is_in_schedule != result.time_is_in_schedule ||
+          expected.seconds != result.seconds)
+        TFAILF(" %s at %ld: %d %u vs %d %u", hrsss[i], (long)time,
+               expected.time_is_in_schedule, expected.seconds,
+               result.time_is_in_schedule, result.seconds);
+    }
+    compiled_destroy(&compiled);
+  }
+}
+
+static void test_compiled_instant(void)
+{
+  static const char *hrsss[] = {
+    "830-12&13-14",
+    "0-1&23-24",
+    "U8-9",
+    "U1-2&3-4.M6-7&8-9",
+    "A23-24.U0-1",
+    "UMTWRFA0-24",
+    "UMTWRFA0-1&2-3&4-5&6-7&8-9&10-11&12-13&14-15&16-17&18-19&20-21&22-23",
+    "B2015M8-12|T8-12",
+    "B2016U1-2&3-4|A23-24",
+    "20150429120000-20150429120001",
+  };
+  a_compiled compiled[DIM(hrsss)];
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i)
+    if (OK != compiled_init(&compiled[i], hrsss[i], strlen(hrsss[i]))) TFAIL();
+  /* every 1001 seconds for 60 days, through the spring DST changes */
+  a_time begin;
+  if (OK != time_parse(&begin, "20150301000000", 14)) TFAIL();
+  int sec = 0;
+  for (; sec < 60 * 24 * 3600; sec += 1001) {
+    a_time t = time_plus(&begin, sec);
+    a_compiled_instant instant;
+    compiled_instant_init(&instant, time_time(&t), t.tz);
+    for (i = 0; i < DIM(hrsss); ++i) {
+      a_remaining_result expected = compiled_remaining(&compiled[i], &t);
+      a_remaining_result result = compiled_instant_remaining(&compiled[i], &instant);
+      if (expected.is_valid != result.is_valid ||
+          expected.time_is_in_schedule != result.time_is_in_schedule ||
+          expected.seconds != result.seconds)
+        TFAILF(" %s at %ld: %d %u vs %d %u", hrsss[i], (long)time_time(&t),
+               expected.time_is_in_schedule, expected.seconds,
+               result.time_is_in_schedule, result.seconds);
+    }
+  }
+  for (i = 0; i < DIM(hrsss); ++i)
+    compiled_destroy(&compiled[i]);
+}
+
+static time_t test_parse_time(const char *s)
+{
+  a_time t;
+  if (OK != time_parse(&t, s, strlen(s))) TFAILF(" %s", s);
+  return time_time(&t);
+}
+
+static void test_compiled_intervals(void)
+{
+  a_compiled compiled;
+  a_compiled_intervals intervals;
+  time_t start, stop;
+  /* 2015-06-08 is a Monday */
+#define OPEN(S, BEGIN, END, IS_IN) do {                                           \
+    if (OK != compiled_init(&compiled, S, strlen(S))) TFAIL();                    \
+    compiled_intervals_init(&intervals, &compiled, time_now()->tz,                \
+                            test_parse_time(BEGIN), test_parse_time(END), IS_IN); \
+  } while_0
+#define NEXT(START, STOP) do {                                                    \
+    if (!compiled_intervals_next(&intervals, &start, &stop)) TFAIL();             \
+    if (test_parse_time(START) != start) TFAILF(" %ld", (long)start);             \
+    if (test_parse_time(STOP) != stop) TFAILF(" %ld", (long)stop);                \
+  } while_0
+#define CLOSE() do {                                                              \
+    if (compiled_intervals_next(&intervals, &start, &stop)) TFAIL();              \
+    compiled_destroy(&compiled);                                                  \
+  } while_0
+  OPEN("0-1&23-24", "20150608120000", "20150610120000", true);
+  NEXT("20150608230000", "20150609010000");
+  NEXT("20150609230000", "20150610010000");
+  CLOSE();
+  OPEN("0-1&23-24", "20150608003000", "20150609233000", false);
+  NEXT("20150608010000", "20150608230000");
+  NEXT("20150609010000", "20150609230000");
+  CLOSE();
+  OPEN("A23-24.U0-1&8-9", "20150613000000", "20150615000000", true);
+  NEXT("20150613230000", "20150614010000");
+  NEXT("20150614080000", "20150614090000");
+  CLOSE();
+  OPEN("UMTWRFA0-24", "20150613000000", "20150615000000", true);
+  NEXT("20150613000000", "20150615000000");
+  CLOSE();
+  OPEN("MWF9-17", "20150609120000", "20150610100000", true);
+  NEXT("20150610090000", "20150610100000");
+  CLOSE();
+  OPEN("now+1h", "20150609120000", "20150610100000", true);
+  NEXT("20150609120000", "20150609130000");
+  CLOSE();
+  OPEN("now+1h", "20150609120000", "20150610100000", false);
+  NEXT("20150609130000", "20150610100000");
+  CLOSE();
+  OPEN("20150609120000-20150609130000", "20150601000000", "20150701000000", true);
+  NEXT("20150609120000", "20150609130000");
+  CLOSE();
+  OPEN("U8-9", "20150608000000", "20150613000000", true);
+  CLOSE();
+#undef OPEN
+#undef NEXT
+#undef CLOSE
+}
+
+/*
+ * Runs in and out of the schedule alternate and cover the window,
+ * including across DST changes.
+ */
+static void test_compiled_intervals_tile(void)
+{
+  static const char *hrsss[] = {
+    "830-12&13-14",
+    "0-1&23-24",
+    "U1-2&3-4.M6-7&8-9",
+    "A23-24.U0-1",
+    "UMTWRFA0-1&2-3&4-5&6-7&8-9&10-11&12-13&14-15&16-17&18-19&20-21&22-23",
+    "B2015M8-12|T8-12",
+    "B2016U1-2&3-4|A23-24",
+  };
+  static const char *windows[][2] = {
+    { "20150301000000", "20150329000000" },
+    { "20151018000000", "20151108000000" },
+  };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    a_compiled compiled;
+    if (OK != compiled_init(&compiled, hrsss[i], strlen(hrsss[i]))) TFAIL();
+    size_t j = 0;
+    for (; j < DIM(windows); ++j) {
+      time_t begin = test_parse_time(windows[j][0]);
+      time_t end = test_parse_time(windows[j][1]);
+      a_compiled_intervals in, out;
+      compiled_intervals_init(&in, &compiled, time_now()->tz, begin, end, true);
+      compiled_intervals_init(&out, &compiled, time_now()->tz, begin, end, false);
+      time_t in_start = 0, in_stop = 0, out_start = 0, out_stop = 0;
+      bool has_in = compiled_intervals_next(&in, &in_start, &in_stop);
+      bool has_out = compiled_intervals_next(&out, &out_start, &out_stop);
+      time_t t = begin;
+      while (has_in || has_out) {
+        if (has_in && in_start == t) {
+          if (in_stop <= t) TFAIL();
+          t = in_stop;
+          has_in = compiled_intervals_next(&in, &in_start, &in_stop);
+        } else if (has_out && out_start == t) {
+          if (out_stop <= t) TFAIL();
+          t = out_stop;
+          has_out = compiled_intervals_next(&out, &out_start, &out_stop);
+        } else {
+          TFAILF(" %s at %ld", hrsss[i], (long)t);
+        }
+        if (has_in && has_out && in_start == out_start) TFAIL();
+      }
+      if (end != t) TFAILF(" %s at %ld", hrsss[i], (long)t);
+    }
+    compiled_destroy(&compiled);
+  }
+}
+
+/*
+ * Counting whole periods at a time agrees with adding up every
+ * interval, across DST changes and over years.
+ */
+static void test_compiled_time_in(void)
+{
+  static const char *hrsss[] = {
+    "830-12&13-14",
+    "0-1&23-24",
+    "MWF9-17",
+    "A23-24.U0-1&2-3",
+    "UMTWRFA0-24",
+    "B2015M8-12|T8-12",
+    "now+1h",
+    "20150609120000-20150609130000",
+  };
+  static const char *windows[][2] = {
+    { "20150608000000", "20150615000000" },
+    { "20150301123456", "20150329000000" },
+    { "20151018000000", "20151108000001" },
+    { "20100101000000", "20200101000000" },
+  };
+  size_t i = 0;
+  for (; i < DIM(hrsss); ++i) {
+    a_compiled compiled;
+    if (OK != compiled_init(&compiled, hrsss[i], strlen(hrsss[i]))) TFAIL();
+    size_t j = 0;
+    for (; j < DIM(windows); ++j) {
+      time_t begin = test_parse_time(windows[j][0]);
+      time_t end = test_parse_time(windows[j][1]);
+      int64_t expected = compiled_intervals_time_in(&compiled, time_now()->tz, begin, end);
+      if (expected != compiled_time_in(&compiled, time_now()->tz, begin, end))
+        TFAILF(" %s %s", hrsss[i], windows[j][0]);
+    }
+    compiled_destroy(&compiled);
+  }
+#define X(S, BEGIN, END, EXPECTED) do {                                          \
+    a_compiled compiled;                                                         \
+    if (OK != compiled_init(&compiled, S, strlen(S))) TFAIL();                   \
+    int64_t in = compiled_time_in(&compiled, time_now()->tz,                     \
+                                  test_parse_time(BEGIN), test_parse_time(END)); \
+    if (EXPECTED != in) TFAILF(" %s %lld", S, (long long)in);                    \
+    compiled_destroy(&compiled);                                                 \
+  } while_0
+  X("MWF9-17", "20150608000000", "20150615000000", 3 * 8 * 3600);
+  X("MWF9-17", "20150608100000", "20150608100000", 0);
+  X("MWF9-17", "20150608100000", "20150608120000", 2 * 3600);
+  X("UMTWRFA0-24", "19800101000000", "20400101000000",
+    test_parse_time("20400101000000") - test_parse_time("19800101000000"));
+#undef X
+}
+
+/*
+ * Combinations are in exactly when the operation on their operands
+ * is, stay so for the seconds remaining, and are written canonically.
+ */
+static void test_compiled_combine(void)
+{
+  static const char *operands[][2] = {
+    { "MWF9-17", "T10-11" },
+    { "MTWRF9-17", "W12-13" },
+    { "9-17", "MWF8-10" },
+    { "8-12", "12-17" },
+    { "A22-24.U0-2", "0-1&2330-24" },
+    { "UMTWRFA0-24", "F0-1&23-24" },
+    { "B2015M8-12|T8-12", "MT9-10" },
+    { "B2015M8-12|T8-12", "B2017M9-13|W9-10" },
+    { "B2016A22-24|U0-2", "0-1&2330-24" },
+  };
+  static const a_compiled_op ops[] = { Union, Intersection, Difference };
+  size_t i = 0;
+  for (; i < DIM(operands); ++i) {
+    a_compiled a, b;
+    if (OK != compiled_init(&a, operands[i][0], strlen(operands[i][0]))) TFAIL();
+    if (OK != compiled_init(&b, operands[i][1], strlen(operands[i][1]))) TFAIL();
+    size_t j = 0;
+    for (; j < DIM(ops); ++j) {
+      a_compiled combined;
+      if (OK != compiled_combine(&combined, &a, &b, ops[j])) TFAIL();
+      time_t t = test_parse_time("20150301000000");
+      for (; t < test_parse_time("20150315000000"); t += 977) {
+        a_time at;
+        time_init(&at, t);
+        a_remaining_result result = compiled_remaining(&combined, &at);
+        bool is_in = compiled_op_apply(ops[j], compiled_remaining(&a, &at).time_is_in_schedule,
+                                       compiled_remaining(&b, &at).time_is_in_schedule);
+        if (result.time_is_in_schedule != is_in)
+          TFAILF(" %s %s at %ld", operands[i][0], operands[i][1], (long)t);
+        if (!result.seconds)
+          continue;
+        time_init(&at, t + result.seconds - 1);
+        is_in = compiled_op_apply(ops[j], compiled_remaining(&a, &at).time_is_in_schedule,
+                                  compiled_remaining(&b, &at).time_is_in_schedule);
+        if (result.time_is_in_schedule != is_in)
+          TFAILF(" %s %s at %ld", operands[i][0], operands[i][1], (long)t);
+      }
+      compiled_destroy(&combined);
+    }
+    compiled_destroy(&a);
+    compiled_destroy(&b);
+  }
+#define X(OP, A, B, EXPECTED) do {                                                \
+    a_compiled a, b, combined;                                                    \
+    char buf[64];                                                                 \
+    if (OK != compiled_init(&a, A, strlen(A))) TFAIL();                           \
+    if (OK != compiled_init(&b, B, strlen(B))) TFAIL();                           \
+    if (OK != compiled_combine(&combined, &a, &b, OP)) TFAIL();                   \
+    if ((int)strlen(EXPECTED) != compiled_format(&combined, buf, sizeof(buf)))    \
+      TFAILF(" %s", buf);                                                         \
+    if (strcmp(EXPECTED, buf)) TFAILF(" %s", buf);                                \
+    compiled_destroy(&a);                                                         \
+    compiled_destroy(&b);                                                         \
+    compiled_destroy(&combined);                                                  \
+  } while_0
+  X(Union, "MWF9-17", "T10-11", "MWF9-17.T10-11");
+  X(Difference, "MTWRF9-17", "W12-13", "MTRF9-17.W9-12&13-17");
+  X(Intersection, "9-17", "MWF8-10", "MWF9-10");
+  X(Union, "8-12", "12-17", "8-17");
+  X(Union, "A22-24", "U0-2", "A22-24.U0-2");
+  X(Union, "UMTWRFA8-9", "8-9", "8-9");
+  X(Union, "830-1215", "M1215-13", "M830-13.TWRFAU830-1215");
+  X(Difference, "8-9", "8-9", "");
+  X(Union, "B2015M8-12|T8-12", "W8-9", "B2015M8-12.W8-9|T8-12.W8-9");
+  X(Difference, "B2015M8-12|T8-12", "M0-24", "B2017T8-12");
+  X(Union, "B2015M8-12", "B2017M8-12", "M8-12");
+  X(Intersection, "B2015M8-12", "B2017M8-12", "");
+  X(Union, "B2015M8-12", "B2016M8-12", "B2015M8-12");
+#undef X
+  a_compiled a, b;
+  char buf[4];
+  if (OK != compiled_init(&a, "9-17", 4)) TFAIL();
+  if (OK != compiled_complement(&b, &a)) TFAIL();
+  if (9 != compiled_format(&b, buf, sizeof(buf)) || strcmp("0-9", buf)) TFAILF(" %s", buf);
+  compiled_destroy(&b);
+  compiled_destroy(&a);
+  /* the complement of 8-9 is in from 9 until 8 the next day */
+  if (OK != compiled_init(&a, "8-9", 3)) TFAIL();
+  if (OK != compiled_complement(&b, &a)) TFAIL();
+  a_compiled_mode mode = Transitions;
+  for (; mode <= Bitmap; ++mode) {
+    compiled_set_mode(&b, mode);
+    a_time at;
+    if (OK != time_parse(&at, "20150610090000", 14)) TFAIL();
+    a_remaining_result result = compiled_remaining(&b, &at);
+    if (!result.time_is_in_schedule || 23 * 3600 != result.seconds) TFAILF(" %u", result.seconds);
+    if (OK != time_parse(&at, "20150610233000", 14)) TFAIL();
+    result = compiled_remaining(&b, &at);
+    if (!result.time_is_in_schedule || 8 * 3600 + 1800 != result.seconds) TFAILF(" %u", result.seconds);
+  }
+  compiled_destroy(&b);
+  compiled_destroy(&a);
+  if (OK != compiled_init(&a, "20150609120000-20150609130000", 29)) TFAIL();
+  if (29 != compiled_format(&a, buf, sizeof(buf)) || strcmp("201", buf)) TFAILF(" %s", buf);
+  if (OK == compiled_complement(&b, &a)) TFAIL();
+  if (OK == compiled_combine(&b, &a, &a, Union)) TFAIL();
+  compiled_destroy(&a);
+}
+
+/* The examples in the README's canonical representation section */
+static void test_compiled_format(void)
+{
+#define X(S, EXPECTED) do {                                                     \
+    a_compiled compiled;                                                        \
+    char buf[64];                                                               \
+    if (OK != compiled_init(&compiled, S, strlen(S))) TFAIL();                  \
+    if ((int)strlen(EXPECTED) != compiled_format(&compiled, buf, sizeof(buf)))  \
+      TFAILF(" %s", buf);                                                       \
+    if (strcmp(EXPECTED, buf)) TFAILF(" %s", buf);                              \
+    compiled_destroy(&compiled);                                                \
+  } while_0
+  X("10-12&13-14", "10-12&13-14");
+  X("M23-24.T0-1", "M23-24.T0-1");
+  X("10-12&11-13", "10-13");
+  X("10-12&12-13", "10-13");
+  X("MWF10-12.T8-9", "MWF10-12.T8-9");
+  X("T8-9.MWF10-12", "MWF10-12.T8-9");
+  X("M10-12&13-15.WF10-12", "M10-12&13-15.WF10-12");
+  X("MWF10-12.M13-15", "M10-12&13-15.WF10-12");
+  X("1000-1200", "10-12");
+  X("0930-1045", "930-1045");
+  X("UMTWRFA8-9", "8-9");
+  X("AU0-24", "AU0-24");
+  X("now+90m", "now+1h30m");
+  X("B2015M8-12|T8-12", "B2015M8-12|T8-12");
+  X("B2015T8-9.M8-9", "B2015MT8-9");
+  X("BMWF10-12|MWF10-12", "MWF10-12");
+  X("B2015UMTWRFA8-9|UMTWRFA8-9", "8-9");
+  X("B2015M8-9|M8-9&10-11", "B2015M8-9|M8-9&10-11");
+  X("P9-17", "P9-17");
+  X("MTWRF9-17", "P9-17");
+  X("MTWRF9-17.A9-17", "MTWRFA9-17");
+  X("MTWRF9-17.W18-19", "MTRF9-17.W9-17&18-19");
+  X("B2015MTWRF9-17|MTWRF9-17", "P9-17");
+  X("20150609120000-20150609130000", "20150609120000-20150609130000");
+#undef X
+}
+
+static void test_compiled_mode(void)
+{
+#define X(S, MODE) do {                                                 \
+    a_compiled compiled;                                                \
+    if (OK != compiled_init(&compiled, S, sizeof(S) - 1)) TFAIL();      \
+    if (MODE != compiled.mode) TFAIL();                                 \
+    compiled_destroy(&compiled);                                        \
+  } while_0
+  X("8-9", Transitions);
+  X("UMTWRFA8-9", Transitions);
+  X("UMTWRFA8-9&10-11", Transitions);
+  X("UMTWRFA0-1&2-3&4-5&6-7&8-9", Bitmap);
+  X("now+1h", Transitions);
+#undef X
+}
+
+PRE_INIT(test_compiled)
+{
+  test_compiled_mode();
+  test_compiled_matches_hrs3_remaining(Transitions);
+  test_compiled_matches_hrs3_remaining(Bitmap);
+  test_compiled_raw_and_now();
+  test_compiled_sweep();
+  test_compiled_cursor();
+  test_compiled_instant();
+  test_compiled_intervals();
+  test_compiled_intervals_tile();
+  test_compiled_time_in();
+  test_compiled_combine();
+  test_compiled_format();
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "a_hrs3.c"
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o compiled compiled.c && ./compiled"
+ * End:
+ */
+
+#endif /* __compiled_c__ */
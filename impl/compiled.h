@@ -0,0 +1,145 @@
+#ifndef __compiled_h__
+#define __compiled_h__
+
+#include "a_hrs3.h"
+#include "bitmap.h"
+#include "remaining.h"
+#include "time.h"
+
+/*
+ * compiled - A parsed hrs3 plus a structure that can be evaluated
+ * repeatedly without parsing or allocating.
+ *
+ * Daily, weekly and biweekly schedules are periodic, so they are
+ * flattened into a sorted table of transitions measured in wall-clock
+ * seconds from the start of the period (midnight for daily, Sunday at
+ * midnight for weekly, and the Sunday of a week that uses the first
+ * half for biweekly).  Even entries start a shift and odd entries
+ * stop it, so a binary search for the first transition after a time
+ * tells both whether the time is in the schedule and when that
+ * changes.  Shifts that abut at midnight are merged, and a shift that
+ * lasts until the end of the period carries on into one that starts
+ * the next.  Raw and now schedules are evaluated from the a_hrs3.
+ *
+ * Schedules with many shifts instead use a bitmap with one bit per
+ * minute of the period, since hrs3 times have minute resolution.
+ * Then whether a time is in the schedule is a single bit test, and
+ * the next boundary is the next bit that differs.
+ */
+
+#define COMPILED_BITMAP_MIN_SHIFTS 32
+
+typedef enum a_compiled_mode {
+  Transitions,
+  Bitmap
+} a_compiled_mode;
+
+typedef enum a_compiled_op {
+  Union,
+  Intersection,
+  Difference
+} a_compiled_op;
+
+typedef struct a_compiled {
+  a_hrs3 hrs3;
+  a_compiled_mode mode;
+  int n_days;  /* length of the period in days, 0 if not periodic */
+  int n_transitions;
+  int *transitions;
+  int period_in; /* seconds in the schedule per period */
+  a_bitmap bitmap; /* one bit per minute of the period, if mode is Bitmap */
+} a_compiled;
+
+/*
+ * A period of a compiled schedule located in unix time, so that times
+ * in it are evaluated by subtracting rather than by converting to
+ * local time.  This needs the UTC offset to be the same for the whole
+ * period and a day either side, so periods near a DST change are
+ * evaluated the usual way.
+ * It is fastest when times are ascending.
+ */
+typedef struct a_compiled_sweep {
+  time_t start;    /* the period is start through stop - 1 */
+  time_t stop;
+  bool is_uniform; /* whether the UTC offset is the same throughout */
+  int offset;      /* of the previous time from start */
+  int next;        /* the first transition after offset */
+  time_t wrap;     /* the first boundary in the next period, 0 if unknown */
+} a_compiled_sweep;
+
+/*
+ * A time prepared for evaluating many compiled schedules: its local
+ * time is converted once, and where its day and week start in unix
+ * time is found once, the first time a daily or weekly schedule needs
+ * it.  As with a_compiled_sweep, that is only used when the UTC offset
+ * doesn't change from a day before the period through a day after the
+ * next one, which is as far as a boundary can be.
+ */
+typedef struct a_compiled_anchor {
+  bool is_located;
+  bool is_uniform;
+  time_t start;
+} a_compiled_anchor;
+
+typedef struct a_compiled_instant {
+  a_time t;
+  a_compiled_anchor day;
+  a_compiled_anchor week;
+  a_compiled_anchor biweek; /* the start of the week, uniform for four weeks */
+} a_compiled_instant;
+
+/*
+ * The runs of time in (or out of) a compiled schedule within a window,
+ * found one at a time.  Runs that continue across midnight or the end
+ * of a week are merged.  A now schedule is fixed at the start of the
+ * window.
+ */
+typedef struct a_compiled_intervals {
+  const a_compiled *compiled;
+  const struct a_tz *tz;
+  bool is_in;    /* whether to find runs in the schedule or out of it */
+  time_t next;   /* where to look for the next run */
+  time_t end;
+  a_time_range now_range; /* if the schedule is a now schedule */
+  a_compiled_sweep sweep;
+} a_compiled_intervals;
+
+/*
+ * Where a compiled schedule was at the last of a series of times that
+ * mostly move forward: the interval the time fell in, until whose
+ * boundary evaluating is a comparison, and the sweep, which moves on
+ * through the transitions from there.
+ */
+typedef struct a_compiled_cursor {
+  const a_compiled *compiled;
+  const struct a_tz *tz;
+  time_t from;     /* the interval is from through boundary - 1 */
+  time_t boundary; /* 0 if there's no interval */
+  bool is_in;
+  a_compiled_sweep sweep;
+} a_compiled_cursor;
+
+status compiled_init(a_compiled *compiled, const char *s, size_t len);
+void compiled_set_mode(a_compiled *compiled, a_compiled_mode mode);
+status compiled_combine(a_compiled *compiled, const a_compiled *a, const a_compiled *b,
+                        a_compiled_op op);
+status compiled_complement(a_compiled *compiled, const a_compiled *a);
+int compiled_format(const a_compiled *compiled, char *buf, size_t size);
+a_remaining_result compiled_remaining(const a_compiled *compiled, const a_time *t);
+void compiled_destroy(a_compiled *compiled);
+void compiled_instant_init(a_compiled_instant *instant, time_t time, const struct a_tz *tz);
+a_remaining_result compiled_instant_remaining(const a_compiled *compiled,
+                                              a_compiled_instant *instant);
+void compiled_intervals_init(a_compiled_intervals *intervals, const a_compiled *compiled,
+                             const struct a_tz *tz, time_t begin, time_t end, bool is_in);
+bool compiled_intervals_next(a_compiled_intervals *intervals, time_t *start, time_t *stop);
+int64_t compiled_time_in(const a_compiled *compiled, const struct a_tz *tz,
+                         time_t begin, time_t end);
+void compiled_sweep_init(a_compiled_sweep *sweep);
+a_remaining_result compiled_sweep_remaining(const a_compiled *compiled, a_compiled_sweep *sweep,
+                                            const a_time *t);
+void compiled_cursor_init(a_compiled_cursor *cursor, const a_compiled *compiled,
+                          const struct a_tz *tz);
+a_remaining_result compiled_cursor_remaining(a_compiled_cursor *cursor, time_t time);
+
+#endif /* __compiled_h__ */
@@ -9,151 +9,121 @@
 #define strdup _strdup
 #endif
 
-void day_clone(a_day *dest, const a_day *src)
-{
-  if (dest->ranges) {
-    day_destroy(dest);
-  }
-  if (src->ranges) {
-    dest->capacity = src->n_ranges;
-    dest->n_ranges = src->n_ranges;
-    dest->ranges = malloc(sizeof(*dest->ranges) * dest->capacity);
-    memcpy(dest->ranges, src->ranges, sizeof(src->ranges[0]) * src->n_ranges);
-  }
-}
-
-void day_copy(a_day *dest, const a_day *src)
-{
-  if (dest->ranges) {
-    day_destroy(dest);
-  }
-  if (src->ranges) {
-    dest->capacity = src->capacity;
-    dest->n_ranges = src->n_ranges;
-    dest->ranges = src->ranges;
-  }
-}
-
 void day_destroy(a_day *day)
 {
-  if (day->ranges)
-    free(day->ranges);
-  day->capacity = 0;
+  arena_free(day->ranges);
   day->n_ranges = 0;
   day->ranges = 0;
 }
 
-/* Merge any overlapping ranges.  Recurse if anything changed. */
-void day_coallesce(a_day *day)
+/* Clear minutes, which has n_days days of words, DAY_MINUTES_WORDS at most. */
+void day_minutes_init(a_bitmap *minutes, uint64_t *words, int n_days)
 {
-  a_military_range *prev = 0;
-  int i = 0;
-  for (; i < day->n_ranges; ++i) {
-    a_military_range *range = &day->ranges[i];
-    if (prev) {
-      if (military_range_overlaps_or_abuts(prev, range)) {
-        /* merge, remove, recurse, and return */
-        military_range_merge(prev, range);
-        memmove(range, range + 1, day->n_ranges - i);
-        day->n_ranges -= 1;
-        day_coallesce(day);
-        return;
-      }
-    }
-    prev = range;
-  }
+  minutes->n_bits = n_days * DAY_MINUTES;
+  minutes->n_words = (minutes->n_bits + 63) / 64;
+  minutes->words = words;
+  memset(words, 0, sizeof(words[0]) * minutes->n_words);
 }
 
-void day_grow(a_day *day)
+/*
+ * Set the minutes of the shifts of s, such as "10-12&13-15", on each
+ * day of mask, bit 0 being minutes' first day.  Without minutes, only
+ * check s.
+ */
+status day_parse_minutes(a_bitmap *minutes, unsigned int mask, const char *s, size_t len)
 {
-  if (!day->capacity)
-    day->capacity = 4;
-  day->capacity *= 2;
-  if (day->ranges)
-    day->ranges = realloc(day->ranges, sizeof(day->ranges[0]) * day->capacity);
-  else
-    day->ranges = malloc(sizeof(day->ranges[0]) * day->capacity);
+  if (!s || !len)
+    return NO;
+  const char *end = s + len;
+  for (;;) {
+    const char *amp = strnchr(s, end - s, '&');
+    const char *stop = amp ? amp : end;
+    a_military_range range;
+    NOD(military_parse_range(&range, s, stop - s));
+    if (minutes) {
+      int start_minute = 60 * range.start.hour + range.start.minute;
+      int stop_minute = 60 * range.stop.hour + range.stop.minute;
+      int i = 0;
+      for (; i < minutes->n_bits / DAY_MINUTES; ++i)
+        if (mask & 1u << i)
+          bitmap_set_range(minutes, i * DAY_MINUTES + start_minute, i * DAY_MINUTES + stop_minute);
+    }
+    if (!amp)
+      return OK;
+    s = amp + 1;
+  }
 }
 
-void day_insert_at(a_day *day, size_t index, const a_military_range *insertee)
+static a_military_time day_minute_to_military(int minute)
 {
-  while (day->capacity <= day->n_ranges)
-    day_grow(day);
-  size_t len = index - day->n_ranges;
-  if (0 < len) {
-    memmove(&day->ranges[index],
-            &day->ranges[index + 1],
-            len);
-  }
-  memcpy(&day->ranges[index], insertee, sizeof(a_military_range));
-  day->n_ranges += 1;
+  a_military_time time = { minute / 60, minute % 60 };
+  return time;
 }
 
-void day_insert(a_day *dest, const a_military_range *range)
+/*
+ * The number of shifts in day i of minutes, which are stored in ranges
+ * if it isn't null.  A run that carries on past midnight into the next
+ * day is cut there.
+ */
+static int day_runs(const a_bitmap *minutes, int i, a_military_range *ranges)
 {
-  int i = 0;
-  for (; i < dest->n_ranges; ++i) {
-    a_military_range *x = &dest->ranges[i];
-    if (military_range_overlaps_or_abuts(range, x)) {
-      /* range and x overlap or abut, so merge them together */
-      military_range_merge(x, range);
-    } else if (military_time_cmp(&range->start, &x->start) < 0) {
-      /* range precedes x so insert range before x */
-      day_insert_at(dest, i, range);
-      break;
+  int n = 0, begin = i * DAY_MINUTES, end = begin + DAY_MINUTES;
+  /* search no further than the end of the day */
+  a_bitmap day = *minutes;
+  day.n_bits = end;
+  day.n_words = (end + 63) / 64;
+  int start = bitmap_find(&day, begin, true);
+  while (0 <= start) {
+    int stop = bitmap_find(&day, start, false);
+    if (stop < 0)
+      stop = end;
+    if (ranges) {
+      ranges[n].start = day_minute_to_military(start - begin);
+      ranges[n].stop = day_minute_to_military(stop - begin);
     }
+    ++n;
+    start = bitmap_find(&day, stop, true);
   }
-  if (i == dest->n_ranges) {
-    /* insert range at end */
-    day_insert_at(dest, i, range);
-  }
-  day_coallesce(dest);
+  return n;
 }
 
-void day_merge(a_day *dest, const a_day *src)
+/*
+ * Set days[0] through days[n_days - 1] to the shifts in minutes.
+ * Their ranges are one allocation, which is returned and which
+ * days[0].ranges points to, so freeing that frees them all.  Return
+ * null if there's no memory for them.
+ */
+a_military_range *day_from_minutes(a_day *days, int n_days, const a_bitmap *minutes)
 {
-  while (dest->capacity < dest->n_ranges + src->n_ranges) {
-    day_grow(dest);
-  }
+  int n_ranges = 0;
   int i = 0;
-  for (; i < src->n_ranges; ++i) {
-    a_military_range *range = &src->ranges[i];
-    day_insert(dest, range);
+  for (; i < n_days; ++i)
+    n_ranges += day_runs(minutes, i, 0);
+  a_military_range *ranges = arena_alloc(sizeof(ranges[0]) * (n_ranges ? n_ranges : 1));
+  if (!ranges)
+    return 0;
+  n_ranges = 0;
+  for (i = 0; i < n_days; ++i) {
+    days[i].ranges = ranges + n_ranges;
+    days[i].n_ranges = day_runs(minutes, i, days[i].ranges);
+    n_ranges += days[i].n_ranges;
   }
-}
-
-/* 10-12 */
-status day_parse_single(a_day *day, const char *s, size_t len)
-{
-  if (day)
-    memset(day, 0, sizeof(a_day));
-  a_military_range range;
-  NOD(military_parse_range(&range, s, len));
-  if (day)
-    day_insert(day, &range);
-  return OK;
+  return ranges;
 }
 
 /* 10-12&13-15 */
 status day_init(a_day *day, const char *s, size_t len)
 {
-  if (!s || !*s)
-    return NO;
-  const char *amp = strnchr(s, len, '&');
-  if (amp) {
-    size_t offset = amp - s;
-    NOD(day_parse_single(day, s, offset));
-    s += offset + 1;
-    len -= offset + 1;
-    a_day rest;
-    NOD(day_init(day ? &rest : 0, s, len));
-    if (day) {
-      day_merge(day, &rest);
-      day_destroy(&rest);
-    }
-    return OK;
+  uint64_t words[(DAY_MINUTES + 63) / 64];
+  a_bitmap minutes;
+  if (day) {
+    memset(day, 0, sizeof(a_day));
+    day_minutes_init(&minutes, words, 1);
   }
-  return day_parse_single(day, s, len);
+  NOD(day_parse_minutes(day ? &minutes : 0, 1, s, len));
+  if (day && !day_from_minutes(day, 1, &minutes))
+    return NO;
+  return OK;
 }
 
 size_t day_to_s(a_day *day, char *buffer)
@@ -175,6 +145,7 @@ char *day_to_s_dup(a_day *day)
   return strdup(buffer);
 }
 
+/* Append the shifts of day on the date of t; see schedule_normalize. */
 void day_add_to_schedule(const a_day *day, const a_time *t, a_schedule *schedule)
 {
   int i = 0;
@@ -182,7 +153,7 @@ void day_add_to_schedule(const a_day *day, const a_time *t, a_schedule *schedule
     a_military_range *range = &day->ranges[i];
     a_time_range time_range_, *time_range = &time_range_;
     if (military_range_to_time_range(range, t, time_range)) {
-      schedule_insert(schedule, time_range);
+      schedule_append(schedule, time_range);
     }
   }
 }
@@ -221,21 +192,49 @@ void test_day_init(void)
 
 void test_day_merge(void)
 {
-#define X(A, B, AB)                                             \
+#define X(S, CANONICAL)                                         \
   do {                                                          \
-    a_day a; if (day_init(&a, A, sizeof(A) - 1)) TFAIL();      \
-    a_day b; if (day_init(&b, B, sizeof(B) - 1)) TFAIL();      \
-    day_merge(&a, &b);                                          \
-    if (strcmp(day_to_s_dup(&a), AB))                           \
-      TFAILF(" '%s' vs '%s'", day_to_s_dup(&a), AB);            \
+    a_day day; if (day_init(&day, S, sizeof(S) - 1)) TFAIL();  \
+    char *s = day_to_s_dup(&day);                               \
+    if (strcmp(s, CANONICAL))                                   \
+      TFAILF(" '%s' vs '%s'", s, CANONICAL);                    \
+    free(s);                                                    \
+    day_destroy(&day);                                          \
   } while_0
-  X("6-7",       "8-9", "6-7&8-9");
-  X("6-7",       "7-8", "6-8");
-  X("6-730",     "7-8", "6-8");
-  X("6-730&8-9", "7-8", "6-9");
+  X("6-7&8-9",        "6-7&8-9");
+  X("8-9&6-7",        "6-7&8-9");
+  X("6-7&7-8",        "6-8");
+  X("6-730&7-8",      "6-8");
+  X("6-730&8-9&7-8",  "6-9");
+  X("7-8&6-730&8-9",  "6-9");
+  X("22-24&0-1&6-7",  "0-1&6-7&22-24");
+  X("0-24&1-2",       "0-24");
 #undef X
 }
 
+/* Many shifts take linear time and no deeper a stack than a few. */
+void test_day_many(void)
+{
+  int n = 200000;
+  size_t len = 0;
+  char *s = malloc(12 * n);
+  int i = 0;
+  for (; i < n; ++i) {
+    int start = (n - 1 - i) % DAY_MINUTES;
+    len += sprintf(s + len, "%s%02d%02d-%02d%02d", i ? "&" : "",
+                   start / 60, start % 60, (start + 1) / 60, (start + 1) % 60);
+  }
+  a_day day;
+  if (day_init(&day, s, len)) TFAIL();
+  if (1 != day.n_ranges) TFAIL();
+  if (0 != military_time_as_seconds_of_day(&day.ranges[0].start)) TFAIL();
+  if (24 * 3600 != military_time_as_seconds_of_day(&day.ranges[0].stop)) TFAIL();
+  day_destroy(&day);
+  s[len - 1] = '-';
+  if (OK == day_init(&day, s, len)) TFAIL();
+  free(s);
+}
+
 void test_daily_remaining(void)
 {
 #define X(x, h, m, s, is_in_schedule, secs)                             \
@@ -286,11 +285,14 @@ PRE_INIT(test_daily)
 {
   test_day_init();
   test_day_merge();
+  test_day_many();
   test_daily_remaining();
 }
 #endif /* RUN_TESTS */
 
 #if ONE_OBJ
+#include "arena.c"
+#include "bitmap.c"
 #include "main.c"
 #include "military.c"
 #include "remaining.c"
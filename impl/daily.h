@@ -1,21 +1,31 @@
 #ifndef __daily_h__
 #define __daily_h__
 
+#include "bitmap.h"
 #include "remaining.h"
 #include "military.h"
 #include "time.h"
 
 typedef struct a_day {
-  int capacity;
   int n_ranges;
   a_military_range *ranges;
 } a_day;
 
+/*
+ * Shifts are parsed into a bitmap of the minutes of up to a week of
+ * days, on the stack, which merges shifts that overlap or abut as they
+ * are set.  Its runs are then each day's shifts, sorted and merged, so
+ * parsing takes time linear in the length of the string and a fixed
+ * amount of memory, however many shifts it has and in whatever order.
+ */
+#define DAY_MINUTES (24 * 60)
+#define DAY_MINUTES_WORDS ((7 * DAY_MINUTES + 63) / 64)
+
 void day_add_to_schedule(const a_day *, const a_time *time, struct a_schedule *schedule);
 status day_init(a_day *day, const char *s, size_t len);
-void day_clone(a_day *dest, const a_day *src);
-void day_copy(a_day *dest, const a_day *src);
 void day_destroy(a_day *day);
-void day_merge(a_day *dest, const a_day *src);
+void day_minutes_init(a_bitmap *minutes, uint64_t *words, int n_days);
+status day_parse_minutes(a_bitmap *minutes, unsigned int mask, const char *s, size_t len);
+a_military_range *day_from_minutes(a_day *days, int n_days, const a_bitmap *minutes);
 
 #endif /* __daily_h__ */
@@ -1,13 +1,21 @@
 #include "a_hrs3.c"
+#include "arena.c"
+#include "bitmap.c"
+#include "biweekly.c"
+#include "cache.c"
+#include "compiled.c"
 #include "daily.c"
+#include "intern.c"
 #include "main.c"
 #include "military.c"
 #include "raw.c"
 #include "now.c"
 #include "remaining.c"
 #include "schedule.c"
+#include "stats.c"
 #include "time_range.c"
 #include "time.c"
+#include "tz.c"
 #include "util.c"
 #include "weekly.c"
 
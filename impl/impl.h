@@ -3,15 +3,23 @@
 
 #include "base.h"
 #include "a_hrs3.h"
+#include "arena.h"
+#include "bitmap.h"
+#include "biweekly.h"
+#include "cache.h"
+#include "compiled.h"
 #include "daily.h"
+#include "intern.h"
 #include "military.h"
 #include "now.h"
 #include "raw.h"
 #include "remaining.h"
 #include "schedule.h"
+#include "stats.h"
 #include "test.h"
 #include "time_range.h"
 #include "time.h"
+#include "tz.h"
 #include "util.h"
 #include "weekly.h"
 
@@ -0,0 +1,215 @@
+#ifndef __intern_c__
+#define __intern_c__
+
+#include "impl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static a_intern_entry **intern_bucket(a_intern *intern, uint64_t hash)
+{
+  return &intern->buckets[hash & (intern->n_buckets - 1)];
+}
+
+/*
+ * Raw times are parsed in the zone they are compiled for, or in the
+ * zone of TZ, so a raw schedule matches only if that is the same.
+ */
+static a_intern_entry *intern_lookup(a_intern *intern, const char *key, size_t len,
+                                     uint64_t hash, const a_tz *tz, const a_tz *parsed_tz)
+{
+  if (!intern->n_buckets)
+    return 0;
+  a_intern_entry *entry = *intern_bucket(intern, hash);
+  for (; entry; entry = entry->next) {
+    if (hash == entry->hash && tz == entry->tz &&
+        (Raw != entry->compiled.hrs3.kind || parsed_tz == entry->parsed_tz) &&
+        0 == strncmp(entry->key, key, len) && 0 == entry->key[len])
+      return entry;
+  }
+  return 0;
+}
+
+static void intern_rehash(a_intern *intern, size_t n_buckets)
+{
+  a_intern_entry **buckets = calloc(n_buckets, sizeof(a_intern_entry *));
+  if (!buckets)
+    return; /* the chains just get longer */
+  a_intern_entry **old = intern->buckets;
+  size_t n_old = intern->n_buckets;
+  intern->buckets = buckets;
+  intern->n_buckets = n_buckets;
+  size_t i = 0;
+  for (; i < n_old; ++i) {
+    a_intern_entry *entry = old[i];
+    while (entry) {
+      a_intern_entry *next = entry->next;
+      a_intern_entry **bucket = intern_bucket(intern, entry->hash);
+      entry->next = *bucket;
+      *bucket = entry;
+      entry = next;
+    }
+  }
+  if (old)
+    free(old);
+}
+
+/*
+ * intern_find returns the entry whose canonical form is key, if there
+ * is one, without compiling anything.  A canonical string is its own
+ * canonical form, so this finds schedules that are written
+ * canonically without parsing them.  The empty string is no schedule,
+ * though a combination that is never in is keyed by it, so it finds
+ * nothing.  Pass a non-null result to intern_release.
+ */
+const a_intern_entry *intern_find(a_intern *intern, const char *key, size_t len,
+                                  const a_tz *tz)
+{
+  if (!len)
+    return 0;
+  uint64_t hash = hash_bytes(key, len);
+  const a_tz *parsed_tz = tz ? tz : tz_local();
+  MUTEX_LOCK(&intern->mutex);
+  a_intern_entry *entry = intern_lookup(intern, key, len, hash, tz, parsed_tz);
+  if (entry)
+    entry->refs += 1;
+  MUTEX_UNLOCK(&intern->mutex);
+  return entry;
+}
+
+/*
+ * intern_add takes compiled, which must not be used afterwards, and
+ * returns the entry for its canonical form: either one already there,
+ * in which case compiled is destroyed, or a new one holding it.  Pass
+ * the result to intern_release.  Without memory for a new entry, it
+ * destroys compiled and returns null.
+ */
+const a_intern_entry *intern_add(a_intern *intern, a_compiled *compiled, const a_tz *tz)
+{
+  /* Format and hash outside of the lock. */
+  int len = compiled_format(compiled, 0, 0);
+  a_intern_entry *entry = len < 0 ? 0 : calloc(1, sizeof(a_intern_entry));
+  if (entry)
+    entry->key = malloc(len + 1);
+  if (!entry || !entry->key) {
+    compiled_destroy(compiled);
+    free(entry);
+    return 0;
+  }
+  compiled_format(compiled, entry->key, len + 1);
+  entry->hash = hash_bytes(entry->key, len);
+  entry->tz = tz;
+  entry->parsed_tz = tz ? tz : tz_local();
+  entry->refs = 1;
+  memcpy(&entry->compiled, compiled, sizeof(a_compiled));
+
+  MUTEX_LOCK(&intern->mutex);
+  a_intern_entry *found = intern_lookup(intern, entry->key, len, entry->hash,
+                                        tz, entry->parsed_tz);
+  if (found) {
+    found->refs += 1;
+  } else {
+    if (intern->n_buckets <= intern->size)
+      intern_rehash(intern, intern->n_buckets ? 2 * intern->n_buckets : 16);
+    a_intern_entry **bucket = intern_bucket(intern, entry->hash);
+    entry->next = *bucket;
+    *bucket = entry;
+    intern->size += 1;
+  }
+  MUTEX_UNLOCK(&intern->mutex);
+  if (!found)
+    return entry;
+  compiled_destroy(&entry->compiled);
+  free(entry->key);
+  free(entry);
+  return found;
+}
+
+void intern_release(a_intern *intern, const a_intern_entry *entry_in)
+{
+  a_intern_entry *entry = (a_intern_entry *)entry_in;
+  MUTEX_LOCK(&intern->mutex);
+  entry->refs -= 1;
+  bool is_garbage = 0 == entry->refs;
+  if (is_garbage) {
+    a_intern_entry **it = intern_bucket(intern, entry->hash);
+    for (; *it; it = &(*it)->next) {
+      if (*it == entry) {
+        *it = entry->next;
+        break;
+      }
+    }
+    intern->size -= 1;
+  }
+  MUTEX_UNLOCK(&intern->mutex);
+  if (!is_garbage)
+    return;
+  compiled_destroy(&entry->compiled);
+  free(entry->key);
+  free(entry);
+}
+
+#if RUN_TESTS
+static const a_intern_entry *test_intern_add(a_intern *intern, const char *s, const a_tz *tz)
+{
+  a_compiled compiled;
+  if (OK != compiled_init(&compiled, s, strlen(s))) TFAIL();
+  return intern_add(intern, &compiled, tz);
+}
+
+static void test_intern_share(void)
+{
+  a_intern intern_ = INTERN_INITIALIZER, *intern = &intern_;
+  const a_intern_entry *a = test_intern_add(intern, "MWF10-12.M13-15", 0);
+  const a_intern_entry *b = test_intern_add(intern, "M10-12&13-15.WF10-12", 0);
+  if (a != b || 2 != a->refs || 1 != intern->size) TFAIL();
+  if (strcmp("M10-12&13-15.WF10-12", a->key)) TFAIL();
+  const a_intern_entry *c = intern_find(intern, "M10-12&13-15.WF10-12", 20, 0);
+  if (c != a || 3 != a->refs) TFAIL();
+  if (intern_find(intern, "MWF10-12.M13-15", 15, 0)) TFAIL(); /* not canonical */
+  if (intern_find(intern, "M10-12&13-15.WF10-12", 20, tz_get("UTC"))) TFAIL();
+  const a_intern_entry *d = test_intern_add(intern, "8-9", 0);
+  if (d == a || 2 != intern->size) TFAIL();
+  intern_release(intern, a);
+  intern_release(intern, b);
+  intern_release(intern, d);
+  if (1 != intern->size) TFAIL();
+  intern_release(intern, c);
+  if (intern->size || intern_find(intern, "8-9", 3, 0)) TFAIL();
+
+  /* many entries, so that the buckets grow */
+  const a_intern_entry *entries[100];
+  int i = 0;
+  for (; i < DIM(entries); ++i) {
+    char s[16];
+    sprintf(s, "%d-%d%02d", i % 20, i % 20 + 1, i / 20);
+    entries[i] = test_intern_add(intern, s, 0);
+  }
+  if (DIM(entries) != intern->size || intern->n_buckets < intern->size) TFAIL();
+  for (i = 0; i < DIM(entries); ++i) {
+    if (entries[i] != intern_find(intern, entries[i]->key, strlen(entries[i]->key), 0))
+      TFAIL();
+    intern_release(intern, entries[i]);
+    intern_release(intern, entries[i]);
+  }
+  if (intern->size) TFAIL();
+  free(intern->buckets);
+}
+
+PRE_INIT(test_intern)
+{
+  test_intern_share();
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "compiled.c"
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o intern intern.c && ./intern"
+ * End:
+ */
+
+#endif /* __intern_c__ */
@@ -0,0 +1,41 @@
+#ifndef __intern_h__
+#define __intern_h__
+
+#include "compiled.h"
+#include "os.h"
+#include <stdint.h>
+
+/*
+ * intern - A thread-safe registry of compiled schedules keyed by their
+ * canonical form, so that schedules that mean the same are compiled
+ * once and shared, however they were written.
+ *
+ * Entries are immutable and reference counted, and an entry is freed
+ * when its last reference is released.
+ */
+
+typedef struct a_intern_entry {
+  struct a_intern_entry *next;  /* next entry in the same bucket */
+  uint64_t hash;                /* of key */
+  int refs;
+  char *key;                    /* the canonical form */
+  const struct a_tz *tz;        /* the zone to evaluate in, null means TZ */
+  const struct a_tz *parsed_tz; /* the zone raw times were parsed in */
+  a_compiled compiled;
+} a_intern_entry;
+
+typedef struct a_intern {
+  a_mutex mutex;
+  size_t size;
+  size_t n_buckets;
+  a_intern_entry **buckets;
+} a_intern;
+
+#define INTERN_INITIALIZER { MUTEX_INITIALIZER }
+
+const a_intern_entry *intern_find(a_intern *intern, const char *key, size_t len,
+                                  const struct a_tz *tz);
+const a_intern_entry *intern_add(a_intern *intern, a_compiled *compiled, const struct a_tz *tz);
+void intern_release(a_intern *intern, const a_intern_entry *entry);
+
+#endif /* __intern_h__ */
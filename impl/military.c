@@ -18,34 +18,45 @@ static char to_numeric(char c)
   return c - '0';
 }
 
+/* Colons are skipped, so "9:30" is "930". */
 static status military_fill(const char *s, size_t len, a_mil_string milstr)
 {
-  if (!s || !*s)
+  if (!s)
     return NO;
-  switch (len) {
+  char d[4];
+  size_t n = 0;
+  const char *end = s + len;
+  for (; s < end; ++s) {
+    if (':' == *s)
+      continue;
+    if (DIM(d) <= n)
+      return NO;
+    d[n++] = *s;
+  }
+  switch (n) {
   case 1: /* 8 */
     milstr[0] = '0';
-    milstr[1] = s[0];
+    milstr[1] = d[0];
     milstr[2] = '0';
     milstr[3] = '0';
     break;
   case 2: /* 12 */
-    milstr[0] = s[0];
-    milstr[1] = s[1];
+    milstr[0] = d[0];
+    milstr[1] = d[1];
     milstr[2] = '0';
     milstr[3] = '0';
     break;
   case 3: /* 120 -> 0120 */
     milstr[0] = '0';
-    milstr[1] = s[0];
-    milstr[2] = s[1];
-    milstr[3] = s[2];
+    milstr[1] = d[0];
+    milstr[2] = d[1];
+    milstr[3] = d[2];
     break;
   case 4:
-    milstr[0] = s[0];
-    milstr[1] = s[1];
-    milstr[2] = s[2];
-    milstr[3] = s[3];
+    milstr[0] = d[0];
+    milstr[1] = d[1];
+    milstr[2] = d[2];
+    milstr[3] = d[3];
     break;
   default:
     return NO;
@@ -86,7 +97,7 @@ int military_time_diff(const a_military_time *later, const a_military_time *prio
   return seconds;
 }
 
-int military_time_as_seconds_of_day(a_military_time *time)
+int military_time_as_seconds_of_day(const a_military_time *time)
 {
   return 3600 * time->hour + 60 * time->minute;
 }
@@ -145,16 +156,16 @@ status military_parse_time(a_military_time *time, const char *s, size_t len)
 
 status military_parse_range(a_military_range* range, const char *s, size_t len)
 {
-  if (!s || !*s)
+  if (!s || !len)
     return NO;
   a_military_time dummy;
   a_military_time *start = range ? &range->start : &dummy;
   a_military_time *stop = range ? &range->stop : &dummy;
   const char *end = s + len;
-  const char *dash = strchr(s, '-');
-  ptrdiff_t dash_offset = dash - s;
-  if (!dash || end <= dash)
+  const char *dash = strnchr(s, len, '-');
+  if (!dash)
     return NO;
+  ptrdiff_t dash_offset = dash - s;
   if (military_parse_time(start, s, dash_offset))
     return NO;
   s = dash + 1;
@@ -199,13 +210,13 @@ bool military_range_to_time_range(const a_military_range *military_range,
                                   const a_time *date,
                                   a_time_range *time_range)
 {
-  a_time clone = time_clone(&time_range->start);
-  if (!military_time_to_time(&military_range->start, date, &time_range->start))
+  a_time start = *date, stop = *date;
+  if (!military_time_to_time(&military_range->start, date, &start))
     return false;
-  if (!military_time_to_time(&military_range->stop, date, &time_range->stop)) {
-    time_copy(&time_range->start, &clone);
+  if (!military_time_to_time(&military_range->stop, date, &stop))
     return false;
-  }
+  time_range->start = time_time(&start);
+  time_range->stop = time_time(&stop);
   return true;
 }
 
@@ -364,6 +375,10 @@ void test_military_parse_time(void)
   X(0, "959", 9, 59);
   X(0, "1000", 10, 0);
   X(0, "2400", 24, 0);
+  X(0, "9:30", 9, 30);
+  X(0, "12:00", 12, 0);
+  X(1, "12:000", 0, 0);
+  X(1, ":", 0, 0);
   X(1, "25", 0, 0);
   X(1, "99", 0, 0);
   X(1, "160", 0, 0);
@@ -436,6 +451,7 @@ void test_military_parse_range(void)
   X(0, "0100-0101",  1,  0,  1,  1);
   X(0, "1234-1543", 12, 34, 15, 43);
   X(0, "0-2400",     0,  0, 24,  0);
+  X(0, "9:30-17:00", 9, 30, 17,  0);
   X(1, "0100-0000",  0,  0,  0,  0);
   X(1, "0100-0100",  0,  0,  0,  0);
   X(1, "0-2401",     0,  0,  0,  0);
@@ -443,6 +459,7 @@ void test_military_parse_range(void)
   XX(1, "0-1&2-3",2, 0,  0,  1,  0);
   XX(1, "0-1&2-3",1, 0,  0,  1,  0);
   XX(1, "0-1&2-3",4, 0,  0,  1,  0);
+  XX(1, "12-13",  2, 0,  0,  0,  0); /* the dash is past len */
 #undef X
 #undef XX
 }
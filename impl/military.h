@@ -14,6 +14,7 @@ typedef struct a_military_range {
 a_military_time military_midnight(void);
 int military_time_cmp(const a_military_time *a, const a_military_time *b);
 int military_time_diff(const a_military_time *later, const a_military_time *prior);
+int military_time_as_seconds_of_day(const a_military_time *time);
 size_t military_time_to_s(const a_military_time *time, char *buffer);
 bool military_time_to_time(const a_military_time *military_time, const struct a_time *date, struct a_time *t);
 bool military_range_to_time_range(const a_military_range *military_range, const struct a_time *date, struct a_time_range *time_range);
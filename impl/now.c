@@ -2,6 +2,7 @@
 #define __now_c__
 
 #include "impl.h"
+#include <stdio.h>
 #include <string.h>
 
 /*
@@ -19,7 +20,7 @@ static size_t now_parse_nun(a_now_range *now_range, const char *s, size_t len)
 {
   char *end = 0;
   int num = s_to_d(s, len, &end);
-  if (0 == num && s == end)
+  if ((0 == num && s == end) || s + len == end)
     return 0;
   switch (*end++) {
   case 'd': now_range->days += num           ; break;
@@ -69,19 +70,45 @@ status now_init(a_now_range *now_range, const char *s, size_t len)
   return NO;
 }
 
+/*
+ * now_to_s writes the shortest string for now_range, such as
+ * "now+1h30m" for "now+90m", without a null.  Days aren't converted
+ * to hours, since a day isn't 24 hours across a DST change.
+ */
+size_t now_to_s(const a_now_range *now_range, char *buffer)
+{
+  int seconds = now_range->seconds;
+  size_t offset = sprintf(buffer, "now+");
+  if (now_range->days)
+    offset += sprintf(&buffer[offset], "%dd", now_range->days);
+  if (seconds < 0) {
+    offset += sprintf(&buffer[offset], "%ds", seconds);
+    return offset;
+  }
+  if (3600 <= seconds)
+    offset += sprintf(&buffer[offset], "%dh", seconds / 3600);
+  if (seconds % 3600 / 60)
+    offset += sprintf(&buffer[offset], "%dm", seconds % 3600 / 60);
+  if (seconds % 60 || (!seconds && !now_range->days))
+    offset += sprintf(&buffer[offset], "%ds", seconds % 60);
+  return offset;
+}
+
 void now_to_time_range(const a_now_range *now_range, const a_time *time, struct a_time_range *range)
 {
-  time_range_init(range, time, 0);
+  a_time stop = time_clone(time);
   if (0 != now_range->days)
-    time_incr_days(&range->stop, now_range->days);
-  time_incr(&range->stop, now_range->seconds);
+    time_incr_days(&stop, now_range->days);
+  time_incr(&stop, now_range->seconds);
+  range->start = time_time(time);
+  range->stop = time_time(&stop);
 }
 
 void now_add_to_schedule(const a_now_range *now_range, const a_time *time, struct a_schedule *schedule)
 {
   a_time_range range_, *range = &range_;
   now_to_time_range(now_range, time, range);
-  schedule_insert(schedule, range);
+  schedule_append(schedule, range);
 }
 
 #if RUN_TESTS
@@ -120,6 +147,30 @@ void test_now_init(void)
 #undef BAD
 }
 
+void test_now_to_s(void)
+{
+#define X(S, EXPECTED)                                                \
+  do {                                                                \
+    a_now_range now_range;                                            \
+    char buffer[NOW_STR_SIZE + 1];                                    \
+    if (OK != now_init(&now_range, S, sizeof(S)-1))                   \
+      TFAIL();                                                        \
+    size_t len = now_to_s(&now_range, buffer);                        \
+    buffer[len] = 0;                                                  \
+    if (0 != strcmp(EXPECTED, buffer))                                \
+      TFAILF("%s != %s", EXPECTED, buffer);                           \
+  } while_0;
+  X("now+1s", "now+1s");
+  X("now+90m", "now+1h30m");
+  X("now+3600s", "now+1h");
+  X("now+1d24h", "now+1d24h");
+  X("now+1d", "now+1d");
+  X("now+0s", "now+0s");
+  X("now+1s1m1s", "now+1m2s");
+  X("now-now+1h", "now+1h");
+#undef X
+}
+
 void test_now_add_to_schedule(void)
 {
   const a_time *now = time_now();
@@ -155,6 +206,7 @@ void test_now_add_to_schedule(void)
 PRE_INIT(test_now)
 {
   test_now_init();
+  test_now_to_s();
   test_now_add_to_schedule();
 }
 #endif
@@ -1,12 +1,15 @@
 #ifndef __now_h__
 #define __now_h__
 
+#define NOW_STR_SIZE (sizeof("now+-2147483648d-2147483648h59m59s") - 1)
+
 typedef struct a_now_range {
   int seconds;
   int days;
 } a_now_range;
 
 status now_init(a_now_range *now_range, const char *s, size_t len);
+size_t now_to_s(const a_now_range *now_range, char *buffer);
 void now_to_time_range(const a_now_range *now_range, const a_time *time, struct a_time_range *range);
 void now_add_to_schedule(const a_now_range *now_range, const a_time *time, struct a_schedule *schedule);
 
@@ -18,4 +18,66 @@
 #define LOCALTIME_R(time, tm) localtime_r(time, tm)
 #endif
 
+#if _WIN32
+#include <windows.h>
+typedef SRWLOCK a_mutex;
+#define MUTEX_INITIALIZER SRWLOCK_INIT
+#define MUTEX_LOCK(m) AcquireSRWLockExclusive(m)
+#define MUTEX_UNLOCK(m) ReleaseSRWLockExclusive(m)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t a_mutex;
+#define MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define MUTEX_LOCK(m) pthread_mutex_lock(m)
+#define MUTEX_UNLOCK(m) pthread_mutex_unlock(m)
+#endif
+
+#if _WIN32
+#include <malloc.h>
+#define ALIGNED_ALLOC(alignment, size) _aligned_malloc(size, alignment)
+#define ALIGNED_FREE(p) _aligned_free(p)
+#else
+#include <stdlib.h>
+#define ALIGNED_ALLOC(alignment, size) aligned_alloc(alignment, size)
+#define ALIGNED_FREE(p) free(p)
+#endif
+
+/* Count trailing zeros of a non-zero 64-bit word. */
+#if _MSC_VER
+#include <intrin.h>
+static __inline int ctz64(unsigned __int64 x)
+{
+  unsigned long i;
+  _BitScanForward64(&i, x);
+  return (int)i;
+}
+#define CTZ64(x) ctz64(x)
+#else
+#define CTZ64(x) __builtin_ctzll(x)
+#endif
+
+/* Word-sized loads and stores that other threads may race with. */
+#if _WIN32
+#define ATOMIC_LOAD(p) (*(volatile long *)(p))
+#define ATOMIC_STORE(p, x) (*(volatile long *)(p) = (x))
+#else
+#define ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, x) __atomic_store_n(p, x, __ATOMIC_RELEASE)
+#endif
+
+/* 64-bit counters that other threads may read while one writes. */
+#if _WIN32
+#define RELAXED_LOAD(p) (*(volatile long long *)(p))
+#define RELAXED_STORE(p, x) (*(volatile long long *)(p) = (x))
+#else
+#define RELAXED_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define RELAXED_STORE(p, x) __atomic_store_n(p, x, __ATOMIC_RELAXED)
+#endif
+
+#if _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 #endif /* __os_h__ */
@@ -15,7 +15,8 @@ static a_schedule schedule_empty(void)
 a_schedule *schedule_create(void)
 {
   a_schedule *schedule = malloc(sizeof(a_schedule));
-  schedule_init(schedule);
+  if (schedule)
+    schedule_init(schedule);
   return schedule;
 }
 
@@ -26,21 +27,29 @@ void schedule_init(a_schedule *schedule)
 
 void schedule_destroy(a_schedule *schedule)
 {
-  if (schedule->ranges)
-    free(schedule->ranges);
+  arena_free(schedule->ranges);
   *schedule = schedule_empty();
 }
 
-void schedule_grow(a_schedule *schedule)
+/*
+ * Double the room for ranges.  Without memory, the schedule stays as
+ * it is but is marked incomplete, so that it evaluates as invalid.
+ */
+status schedule_grow(a_schedule *schedule)
 {
-  if (0 == schedule->capacity) {
-    schedule->capacity = 8;
-    schedule->ranges = malloc(sizeof(a_time_range) * schedule->capacity);
-  } else {
-    schedule->capacity *= 2;
-    schedule->ranges = realloc(schedule->ranges,
-                               sizeof(a_time_range) * schedule->capacity);
+  STATS_INCR(STAT_GROWS);
+  int capacity = schedule->capacity ? 2 * schedule->capacity : 8;
+  a_time_range *ranges = schedule->capacity
+    ? arena_realloc(schedule->ranges, sizeof(a_time_range) * schedule->capacity,
+                    sizeof(a_time_range) * capacity)
+    : arena_alloc(sizeof(a_time_range) * capacity);
+  if (!ranges) {
+    schedule->is_incomplete = true;
+    return NO;
   }
+  schedule->capacity = capacity;
+  schedule->ranges = ranges;
+  return OK;
 }
 
 bool schedule_has_range(a_schedule *schedule, a_time_range *range)
@@ -48,8 +57,7 @@ bool schedule_has_range(a_schedule *schedule, a_time_range *range)
   int i = 0;
   for (; i < schedule->n_ranges; ++i) {
     a_time_range *x = &schedule->ranges[i];
-    if (0 == time_cmp(&x->start, &range->start) &&
-        0 == time_cmp(&x->stop, &range->stop))
+    if (x->start == range->start && x->stop == range->stop)
       return true;
   }
   return false;
@@ -58,11 +66,12 @@ bool schedule_has_range(a_schedule *schedule, a_time_range *range)
 static void schedule_insert_at(a_schedule *schedule, int index, a_time_range *range)
 {
   while (schedule->capacity <= schedule->n_ranges) {
-    schedule_grow(schedule);
+    if (OK != schedule_grow(schedule))
+      return;
   }
   void *dest = &schedule->ranges[index + 1];
   void *src = &schedule->ranges[index];
-  size_t size = sizeof(a_schedule) * (schedule->n_ranges - index);
+  size_t size = sizeof(a_time_range) * (schedule->n_ranges - index);
   memmove(dest, src, size);
   time_range_copy(&schedule->ranges[index], range);
   schedule->n_ranges++;
@@ -87,51 +96,119 @@ static void schedule_insert_at(a_schedule *schedule, int index, a_time_range *ra
  *
  * ^                   ^
  * +-------------------+  <- schedule
+ *
+ * Each insertion takes time linear in the size of the schedule; to
+ * add many ranges, append them and normalize once instead.
  */
 void schedule_insert(a_schedule *schedule, a_time_range *range)
 {
-  bool inserted_or_merged = false;
+  a_time_range *ranges = schedule->ranges;
+  int n = schedule->n_ranges;
+  /* ranges i through j - 1 overlap or abut range */
   int i = 0;
-  for(; i < schedule->n_ranges; ++i) {
-    a_time_range *x = &schedule->ranges[i];
-    if (!inserted_or_merged && 0 < time_diff(&range->start, &x->stop)) {
-      /* x->stop precedes range->start, so continue to next x */
-      continue;
-    }
-    if (time_range_overlaps_or_abuts(x, range)) {
-      /* range and x overlap, so merge all overlapping ranges */
-      time_range_merge(x, range);
-      if (inserted_or_merged)
-        schedule->n_ranges--;
-      inserted_or_merged = true;
-      continue;
+  while (i < n && ranges[i].stop < range->start)
+    ++i;
+  int j = i;
+  while (j < n && ranges[j].start <= range->stop)
+    ++j;
+  if (i == j) {
+    schedule_insert_at(schedule, i, range);
+    return;
+  }
+  time_range_merge(&ranges[i], range);
+  time_range_merge(&ranges[i], &ranges[j - 1]);
+  memmove(&ranges[i + 1], &ranges[j], sizeof(a_time_range) * (n - j));
+  schedule->n_ranges -= j - i - 1;
+  STATS_INCR(STAT_MERGES);
+}
+
+/* Add range to the end of schedule, without ordering or merging it. */
+void schedule_append(a_schedule *schedule, const a_time_range *range)
+{
+  while (schedule->capacity <= schedule->n_ranges) {
+    if (OK != schedule_grow(schedule))
+      return;
+  }
+  schedule->ranges[schedule->n_ranges++] = *range;
+}
+
+static int schedule_cmp_starts(const void *a, const void *b)
+{
+  int64_t x = ((const a_time_range *)a)->start;
+  int64_t y = ((const a_time_range *)b)->start;
+  return x < y ? -1 : y < x ? 1 : 0;
+}
+
+/*
+ * schedule_normalize sorts the ranges of a schedule by start, unless
+ * they already are, and then merges those that overlap or abut in one
+ * pass, so that a schedule of k appended ranges is built in O(k log k)
+ * time rather than the O(k^2) of inserting them one at a time.
+ */
+void schedule_normalize(a_schedule *schedule)
+{
+  a_time_range *ranges = schedule->ranges;
+  int n = schedule->n_ranges;
+  int i = 1;
+  for (; i < n; ++i)
+    if (ranges[i].start < ranges[i - 1].start)
+      break;
+  if (i < n && n <= 16) {
+    /* insertion sort is quicker than qsort for a few */
+    for (; i < n; ++i) {
+      a_time_range range = ranges[i];
+      int j = i;
+      for (; 0 < j && range.start < ranges[j - 1].start; --j)
+        ranges[j] = ranges[j - 1];
+      ranges[j] = range;
     }
-    if (!inserted_or_merged) {
-      /* range precedes x */
-      schedule_insert_at(schedule, i, range);
-      inserted_or_merged = true;
+  } else if (i < n) {
+    qsort(ranges, n, sizeof(ranges[0]), schedule_cmp_starts);
+  }
+  int n_merged = n ? 1 : 0;
+  for (i = 1; i < n; ++i) {
+    a_time_range *last = &ranges[n_merged - 1];
+    if (last->stop < ranges[i].start) {
+      ranges[n_merged++] = ranges[i];
+    } else {
+      if (last->stop < ranges[i].stop)
+        last->stop = ranges[i].stop;
+      STATS_INCR(STAT_MERGES);
     }
   }
-  if (!inserted_or_merged) {
-    schedule_insert_at(schedule, i, range);
+  schedule->n_ranges = n_merged;
+}
+
+/* Add n ranges, in any order, to schedule; see schedule_normalize. */
+void schedule_insert_many(a_schedule *schedule, const a_time_range *ranges, int n)
+{
+  while (schedule->capacity < schedule->n_ranges + n) {
+    if (OK != schedule_grow(schedule))
+      return;
   }
+  memcpy(&schedule->ranges[schedule->n_ranges], ranges, sizeof(ranges[0]) * n);
+  schedule->n_ranges += n;
+  schedule_normalize(schedule);
 }
 
 a_remaining_result schedule_remaining(const a_schedule *schedule, const a_time *t)
 {
+  if (schedule->is_incomplete)
+    return remaining_invalid();
+  int64_t time = time_time(t);
   int i = 0;
   for(; i < schedule->n_ranges; ++i) {
     a_time_range *range = &schedule->ranges[i];
-    if (!time_precedes(t, &range->stop))
+    if (range->stop <= time)
       continue;
     int seconds = 0;
     bool is_in_range = false;
-    if (time_range_contains(range, t)) {
+    if (range->start <= time) {
       is_in_range = true;
-      seconds = time_diff(&range->stop, t);
+      seconds = (int)(range->stop - time);
     } else {
       is_in_range = false;
-      seconds = time_diff(&range->start, t);
+      seconds = (int)(range->start - time);
     }
     a_remaining_result result = { 1, is_in_range, seconds };
     return result;
@@ -163,7 +240,7 @@ static char *schedule_to_s_(a_schedule *schedule)
   return buffer;
 }
 
-PRE_INIT(test_schedule)
+static void test_schedule_insert(void)
 {
   a_time_range range = time_range_empty();
   a_schedule s = schedule_empty();
@@ -198,13 +275,57 @@ PRE_INIT(test_schedule)
   X(&now, 30, 1);
   time_range_init(&range, &now, 30);
   if (!schedule_has_range(&s, &range)) TFAIL();
+  time_incr(&later, 100);
+  X(&later, 1, 2);
+  time_incr(&later, 2);
+  X(&later, 1, 3);
+  time_incr(&later, -3);
+  X(&later, 5, 2);
+  time_range_init(&range, &later, 5);
+  if (!schedule_has_range(&s, &range)) TFAIL();
 #undef X
+  schedule_destroy(&s);
+}
+
+static void test_schedule_insert_many(void)
+{
+  const a_time *now = time_now();
+  /* 1000 ranges of 2 seconds, 3 apart, and then their gaps, shuffled */
+  a_time_range *ranges = malloc(sizeof(a_time_range) * 2000);
+  int n = 0, i = 0;
+  for (; i < 1000; ++i, ++n) {
+    a_time start = time_plus(now, 3 * (i * 7 % 1000));
+    time_range_init(&ranges[n], &start, 2);
+  }
+  a_schedule s = schedule_empty();
+  schedule_insert_many(&s, ranges, n);
+  if (1000 != s.n_ranges) TFAILF(" %d", s.n_ranges);
+  for (i = 1; i < s.n_ranges; ++i)
+    if (3 != s.ranges[i].start - s.ranges[i - 1].start) TFAIL();
+  for (i = 0; i < 999; ++i, ++n) {
+    a_time start = time_plus(now, 3 * (i * 13 % 999) + 2);
+    time_range_init(&ranges[n], &start, 1);
+  }
+  schedule_insert_many(&s, &ranges[1000], 999);
+  a_time_range all;
+  time_range_init(&all, now, 2999);
+  if (1 != s.n_ranges || !schedule_has_range(&s, &all)) TFAIL();
+  schedule_destroy(&s);
+  free(ranges);
+}
+
+PRE_INIT(test_schedule)
+{
+  test_schedule_insert();
+  test_schedule_insert_many();
 }
 #endif /* RUN_TESTS */
 
 #if ONE_OBJ
+#include "arena.c"
 #include "main.c"
 #include "remaining.c"
+#include "stats.c"
 #include "time_range.c"
 #endif
 
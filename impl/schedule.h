@@ -9,12 +9,16 @@ typedef struct a_schedule {
   int capacity;
   int n_ranges;
   a_time_range *ranges;
+  bool is_incomplete; /* a range was dropped for want of memory */
 } a_schedule;
 
 void schedule_init(a_schedule *schedule);
 void schedule_destroy(a_schedule *schedule);
-void schedule_grow(a_schedule *schedule);
+status schedule_grow(a_schedule *schedule);
 void schedule_insert(a_schedule *schedule, struct a_time_range *range);
+void schedule_append(a_schedule *schedule, const struct a_time_range *range);
+void schedule_normalize(a_schedule *schedule);
+void schedule_insert_many(a_schedule *schedule, const struct a_time_range *ranges, int n);
 a_remaining_result schedule_remaining(const a_schedule *schedule, const struct a_time *t);
 size_t schedule_to_s(const a_schedule *schedule, char *buffer, size_t size);
 
@@ -0,0 +1,164 @@
+#ifndef __stats_c__
+#define __stats_c__
+
+#include "impl.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if STATS
+THREAD_LOCAL a_stats *stats_mine;
+#endif
+
+static a_mutex stats_mutex = MUTEX_INITIALIZER;
+static a_stats *stats_all;
+static long long stats_base[N_STATS]; /* the sums as of the last reset */
+
+#if STATS && !_WIN32
+/*
+ * When a thread exits, its block goes to the next new thread, which
+ * counts on from where it left off.  On Windows, blocks aren't reused.
+ */
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+static void stats_release(void *stats)
+{
+  MUTEX_LOCK(&stats_mutex);
+  ((a_stats *)stats)->in_use = false;
+  MUTEX_UNLOCK(&stats_mutex);
+}
+
+static void stats_key_create(void)
+{
+  pthread_key_create(&stats_key, stats_release);
+}
+#endif
+
+#if STATS
+/* Give this thread a block to count into. */
+a_stats *stats_claim(void)
+{
+  MUTEX_LOCK(&stats_mutex);
+  a_stats *stats = stats_all;
+  for (; stats; stats = stats->next)
+    if (!stats->in_use)
+      break;
+  if (!stats) {
+    stats = calloc(1, sizeof(a_stats));
+    stats->next = stats_all;
+    stats_all = stats;
+  }
+  stats->in_use = true;
+  MUTEX_UNLOCK(&stats_mutex);
+#if !_WIN32
+  pthread_once(&stats_once, stats_key_create);
+  pthread_setspecific(stats_key, stats);
+#endif
+  stats_mine = stats;
+  return stats;
+}
+#endif
+
+static void stats_sum(long long counts[N_STATS])
+{
+  memset(counts, 0, sizeof(long long) * N_STATS);
+  a_stats *stats = stats_all;
+  for (; stats; stats = stats->next) {
+    int i = 0;
+    for (; i < N_STATS; ++i)
+      counts[i] += RELAXED_LOAD(&stats->counts[i]);
+  }
+}
+
+/* The counts of all threads since the last reset. */
+void stats_get(long long counts[N_STATS])
+{
+  MUTEX_LOCK(&stats_mutex);
+  stats_sum(counts);
+  int i = 0;
+  for (; i < N_STATS; ++i)
+    counts[i] -= stats_base[i];
+  MUTEX_UNLOCK(&stats_mutex);
+}
+
+/*
+ * Start counting from 0.  The blocks aren't cleared, since their
+ * threads may be counting into them; the sums so far are remembered
+ * instead, and taken off later sums.
+ */
+void stats_reset(void)
+{
+  MUTEX_LOCK(&stats_mutex);
+  stats_sum(stats_base);
+  MUTEX_UNLOCK(&stats_mutex);
+}
+
+#if RUN_TESTS
+#if STATS && !_WIN32
+static void *test_stats_thread(void *arg)
+{
+  (void)arg;
+  STATS_INCR(STAT_GROWS);
+  STATS_INCR(STAT_GROWS);
+  return 0;
+}
+
+/* Counts outlive their thread, and its block goes to the next one. */
+static void test_stats_threads(void)
+{
+  stats_reset();
+  a_stats *before = stats_all;
+  pthread_t thread;
+  pthread_create(&thread, 0, test_stats_thread, 0);
+  pthread_join(thread, 0);
+  pthread_create(&thread, 0, test_stats_thread, 0);
+  pthread_join(thread, 0);
+  long long counts[N_STATS];
+  stats_get(counts);
+  if (4 != counts[STAT_GROWS]) TFAILF(" %lld", counts[STAT_GROWS]);
+  if (stats_all == before || stats_all->next != before) TFAIL(); /* one new block */
+}
+#endif
+
+static void test_stats_get(void)
+{
+  long long counts[N_STATS];
+  stats_reset();
+  stats_get(counts);
+  int i = 0;
+  for (; i < N_STATS; ++i)
+    if (counts[i]) TFAILF(" %d", i);
+  STATS_INCR(STAT_PARSES);
+  STATS_INCR(STAT_MERGES);
+  STATS_INCR(STAT_MERGES);
+  stats_get(counts);
+#if STATS
+  if (1 != counts[STAT_PARSES] || 2 != counts[STAT_MERGES] || counts[STAT_GROWS]) TFAIL();
+#else
+  if (counts[STAT_PARSES] || counts[STAT_MERGES]) TFAIL();
+#endif
+  stats_reset();
+  stats_get(counts);
+  if (counts[STAT_PARSES] || counts[STAT_MERGES]) TFAIL();
+}
+
+PRE_INIT(test_stats)
+{
+  test_stats_get();
+#if STATS && !_WIN32
+  test_stats_threads();
+#endif
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "main.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o stats stats.c && ./stats"
+ * End:
+ */
+
+#endif /* __stats_c__ */
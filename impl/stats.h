@@ -0,0 +1,47 @@
+#ifndef __stats_h__
+#define __stats_h__
+
+#include "os.h"
+
+/*
+ * stats - Counts of the costly steps of evaluating schedules, to see
+ * why a schedule is slow.
+ *
+ * Each thread counts into its own block, which only it writes, so
+ * counting is a plain increment.  Reading adds up the blocks of all
+ * threads.  Build with STATS defined as 0 to count nothing.
+ */
+
+typedef enum a_stat {
+  STAT_PARSES,     /* hrs3 strings parsed */
+  STAT_MKTIMES,    /* local times turned into times, as by mktime */
+  STAT_LOCALTIMES, /* times turned into local times, as by localtime_r */
+  STAT_GROWS,      /* schedules grown */
+  STAT_MERGES,     /* ranges merged into a schedule's ranges */
+  STAT_LOOKAHEADS, /* days or weeks looked ahead by hrs3_remaining */
+  N_STATS
+} a_stat;
+
+typedef struct a_stats {
+  struct a_stats *next; /* in the list of all threads' blocks */
+  long in_use;          /* by a thread that hasn't exited */
+  long long counts[N_STATS];
+} a_stats;
+
+#if STATS
+extern THREAD_LOCAL a_stats *stats_mine;
+a_stats *stats_claim(void);
+#define STATS_INCR(stat)                                           \
+  do {                                                             \
+    a_stats *_stats = stats_mine ? stats_mine : stats_claim();     \
+    RELAXED_STORE(&_stats->counts[stat],                           \
+                  RELAXED_LOAD(&_stats->counts[stat]) + 1);        \
+  } while_0
+#else
+#define STATS_INCR(stat) do { } while_0
+#endif
+
+void stats_get(long long counts[N_STATS]);
+void stats_reset(void);
+
+#endif /* __stats_h__ */
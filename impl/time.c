@@ -47,7 +47,7 @@ void time_incr(a_time *t, int sec)
 {
   if (0 != sec) {
     time_t stamp = time_time(t);
-    time_init(t, stamp + sec);
+    time_init_tz(t, stamp + sec, t->tz);
   }
 }
 
@@ -76,15 +76,17 @@ void time_next_day(a_time *t)
 {
   /*
    * Most days are 3600 * 24 seconds, but some have +/- 1 leap second
-   * and others have +/- 3600 because of DST.
+   * and others have +/- 3600 because of DST, so go by the calendar.
+   * If midnight is skipped, the day starts when the clock jumps.
    */
+  const struct tm *tm = time_tm(t);
 #if CHECK
-  int tm_wday = time_tm(t)->tm_wday;
+  int tm_wday = tm->tm_wday;
 #endif
-  if (!time_hms(t, 23, 59, 59) && !time_hms(t, 23, 59, 58))
+  int year = tm->tm_year + 1900, mon = tm->tm_mon + 1, mday = tm->tm_mday;
+  date_incr(&year, &mon, &mday, 1);
+  if (!time_ymdhms(t, year, mon, mday, 0, 0, 0))
     BUG();
-  while (time_tm(t)->tm_sec != 0)
-    time_incr(t, 1);
 #if CHECK
   if (0 != time_tm(t)->tm_hour) BUG();
   if (0 != time_tm(t)->tm_min) BUG();
@@ -119,13 +121,17 @@ time_t time_time(const a_time *t)
   return t->time;
 }
 
+/*
+ * tm is worked out the first time it's asked for, and kept in t.  So
+ * a time that other threads can see must have it worked out already.
+ */
 const struct tm *time_tm(const a_time *t)
 {
   if (!t->tm.tm_year) {
 #if CHECK
     if (!t->time) BUG();
 #endif
-    LOCALTIME_R(&t->time, (struct tm *)&t->tm);
+    tz_localtime(t->tz, t->time, (struct tm *)&t->tm);
   }
   return &t->tm;
 }
@@ -144,10 +150,17 @@ a_time *time_maximum(const a_time *a, const a_time *b)
   return (a_time *)(time_a < time_b ? b : a);
 }
 
+/* Initialize t in the local zone, see tz_local. */
 void time_init(a_time *t, time_t time)
+{
+  time_init_tz(t, time, tz_local());
+}
+
+void time_init_tz(a_time *t, time_t time, const a_tz *tz)
 {
   t->time = time;
   memset(&t->tm, 0, sizeof(struct tm));
+  t->tz = tz;
 }
 
 /*
@@ -254,10 +267,10 @@ bool time_ymdhms(a_time *t,
    target_tm.tm_sec = sec;
    target_tm.tm_isdst = -1;
    a_time target;
-   time_t tt = mktime(&target_tm);
+   time_t tt = tz_mktime(t->tz, &target_tm);
    if (-1 == tt)
      return false;
-   time_init(&target, tt);
+   time_init_tz(&target, tt, t->tz);
    bool target_is_future = 0 < time_diff(&target, t) ? true : false;
    int dst_check_offset = target_is_future ? -3600 : 3600;
    a_time dst_check = time_clone(&target);
@@ -289,6 +302,40 @@ int days_in_mon(int nmon, int nyear)
   return 0;
 }
 
+/*
+ * Move a calendar date by 'days' days, which may be negative.  Unlike
+ * mktime, the result is normalized without regard to time zones.
+ */
+void date_incr(int *year, int *mon, int *mday, int days)
+{
+  for (; 0 < days; --days) {
+    if (*mday < days_in_mon(*mon, *year)) {
+      *mday += 1;
+    } else {
+      *mday = 1;
+      if (12 == *mon) {
+        *mon = 1;
+        *year += 1;
+      } else {
+        *mon += 1;
+      }
+    }
+  }
+  for (; days < 0; ++days) {
+    if (1 < *mday) {
+      *mday -= 1;
+    } else {
+      if (1 == *mon) {
+        *mon = 12;
+        *year -= 1;
+      } else {
+        *mon -= 1;
+      }
+      *mday = days_in_mon(*mon, *year);
+    }
+  }
+}
+
 size_t time_string_length(void)
 {
   return sizeof("CCYYMMDDHHMMSS") - 1; /* 14 */
@@ -310,9 +357,10 @@ status time_parse(a_time *out, const char *s, size_t len)
   int minute = s_to_d(s, 2, 0); s += 2;
   if (minute < 0 || 60 <= minute) return NO;
   int second = s_to_d(s, 2, 0); /* s += 2; scan-build: dead increment */
-  time_copy(out, time_now());
+  time_init(out, time_time(time_now()));
   if (!time_ymdhms(out, year, mon, day, hour, minute, second))
     return NO;
+  time_tm(out); /* parsed times end up in shared schedules, which are only read */
   return OK;
 }
 
@@ -330,29 +378,24 @@ size_t time_to_s(const a_time *t, char *buffer)
   return 14;
 }
 
+/*
+ * Each thread has its own now, since threads can be in different
+ * zones.  Its tm is filled in here so that callers only read it.
+ */
 const a_time *time_now()
 {
-  static a_time now;
+  static THREAD_LOCAL a_time now;
+  const a_tz *tz = tz_local();
   if (!now.time)
-    time_init(&now, time(0));
+    time_init_tz(&now, time(0), tz);
+  else if (now.tz != tz)
+    time_init_tz(&now, now.time, tz); /* same time, this zone */
+  else
+    return &now;
+  time_tm(&now);
   return &now;
 }
 
-#if _WIN32
-PRE_INIT(cygwin_tz_fix)
-{
-  // http://cygwin.1069669.n5.nabble.com/Re-PATCH-Setting-TZ-may-break-time-in-non-Cygwin-programs-tt90762.html
-  const char *tz = getenv("TZ");
-  if (!tz || strlen(tz) < 5)
-    return;
-  if ('0' <= tz[3] && tz[3] <= '9')
-    return;
-  if ('0' <= tz[4] && tz[4] <= '9' && ('-' == tz[3] || '+' == tz[3]))
-    return;
-  _putenv("TZ=");
-}
-#endif
-
 #if RUN_TESTS
 static void test_time_(void)
 {
@@ -415,6 +458,24 @@ static void test_time_parse(void)
 #undef X
 }
 
+static void test_date_incr(void)
+{
+#define X(Y, M, D, DAYS, Y2, M2, D2) do {                              \
+    int year = Y, mon = M, mday = D;                                  \
+    date_incr(&year, &mon, &mday, DAYS);                              \
+    if (Y2 != year || M2 != mon || D2 != mday)                        \
+      TFAILF(" %d-%d-%d", year, mon, mday);                           \
+  } while_0
+  X(2015, 10, 29,   3, 2015, 11,  1);
+  X(2015, 12, 31,   1, 2016,  1,  1);
+  X(2016,  2, 28,   1, 2016,  2, 29);
+  X(2015,  2, 28,   1, 2015,  3,  1);
+  X(2016,  3,  1,  -1, 2016,  2, 29);
+  X(2016,  1,  1, -14, 2015, 12, 18);
+  X(2016,  1,  1,   0, 2016,  1,  1);
+#undef X
+}
+
 static void test_is_leap_year(void)
 {
 #define X(yn, nyear)                                                  \
@@ -435,11 +496,13 @@ PRE_INIT(test_time)
   test_time_ymdhms();
   test_time_parse();
   test_is_leap_year();
+  test_date_incr();
 }
 #endif /* RUN_TESTS */
 
 #if ONE_OBJ
 #include "main.c"
+#include "tz.c"
 #include "util.c"
 #endif
 
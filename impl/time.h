@@ -7,11 +7,12 @@
 
 /*
  * Sometimes we want a timestamp (time_t), and sometimes a struct tm
- * (in localtime).
+ * (in localtime).  Times derived from a time keep its zone.
  */
 typedef struct a_time {
   time_t time;  /* 0 means unset */
   struct tm tm; /* a tm_year of 0 means unset */
+  const struct a_tz *tz; /* null means libc's zone */
 } a_time;
 
 int time_cmp(const a_time *a, const a_time *b);
@@ -27,11 +28,13 @@ a_time *time_maximum(const a_time *a, const a_time *b);
 time_t time_time(const a_time *t);
 const struct tm *time_tm(const a_time *t);
 void time_init(a_time *t, time_t time);
+void time_init_tz(a_time *t, time_t time, const struct a_tz *tz);
 a_time time_clone(const a_time *src);
 void time_copy(a_time *dest, const a_time *src);
 bool time_hms(a_time *t, int hour, int min, int sec);
 bool time_whms(a_time *t, int wday, int hour, int min, int sec);
 bool time_ymdhms(a_time *t, int year, int mon, int mday, int hour, int min, int sec);
+void date_incr(int *year, int *mon, int *mday, int days);
 status time_parse(a_time *time, const char *s, size_t len);
 size_t time_to_s(const a_time *t, char *buffer);
 const a_time *time_now(void);
@@ -10,61 +10,54 @@ a_time_range time_range_empty(void)
   return x;
 }
 
-bool time_range_contains(a_time_range *range, const a_time *t)
+bool time_range_contains(const a_time_range *range, const a_time *t)
 {
-  bool x = time_cmp(&range->start, t) <= 0;
-  bool y = time_cmp(t, &range->stop) < 0;
-  return x && y;
+  int64_t time = time_time(t);
+  return range->start <= time && time < range->stop;
 }
 
-bool time_range_overlaps_or_abuts(a_time_range *a, a_time_range *b)
+bool time_range_overlaps_or_abuts(const a_time_range *a, const a_time_range *b)
 {
-  a_time *start = time_maximum(&a->start, &b->start);
-  a_time *stop = time_minimum(&a->stop, &b->stop);
-  return (0 <= time_diff(stop, start)) ? true : false;
+  int64_t start = a->start < b->start ? b->start : a->start;
+  int64_t stop = a->stop < b->stop ? a->stop : b->stop;
+  return start <= stop ? true : false;
 }
 
-a_time_range *time_range_overlap_alloc(a_time_range *range,
-                                       a_time_range *during)
+a_time_range *time_range_overlap_alloc(const a_time_range *range,
+                                       const a_time_range *during)
 {
-  a_time *start = time_maximum(&range->start, &during->start);
-  a_time *stop = time_minimum(&range->stop, &during->stop);
-  if (time_diff(stop, start) <= 0)
+  int64_t start = range->start < during->start ? during->start : range->start;
+  int64_t stop = range->stop < during->stop ? range->stop : during->stop;
+  if (stop <= start)
     return 0;
   a_time_range *ret = malloc(sizeof(a_time_range));
-  memcpy(&ret->start, start, sizeof(a_time));
-  memcpy(&ret->stop, stop, sizeof(a_time));
+  ret->start = start;
+  ret->stop = stop;
   return ret;
 }
 
-void time_range_copy(a_time_range *dest, a_time_range *src)
+void time_range_copy(a_time_range *dest, const a_time_range *src)
 {
-  memcpy(dest, src, sizeof(a_time_range));
+  *dest = *src;
 }
 
-void time_range_merge(a_time_range *dest, a_time_range *src)
+void time_range_merge(a_time_range *dest, const a_time_range *src)
 {
-  time_copy(&dest->start, time_minimum(&dest->start, &src->start));
-  time_copy(&dest->stop, time_maximum(&dest->stop, &src->stop));
+  if (src->start < dest->start)
+    dest->start = src->start;
+  if (dest->stop < src->stop)
+    dest->stop = src->stop;
 }
 
 void time_range_init(a_time_range *range, const a_time *start, int seconds)
 {
-  time_copy(&range->start, start);
 #if CHECK
   if (seconds < 0) {
     BUG();
   }
 #endif
-  time_copy(&range->stop, start);
-  time_incr(&range->stop, seconds);
-}
-
-status time_range_verify(a_time_range *range)
-{
-  if (0 <= time_cmp(&range->start, &range->stop))
-    return NO;
-  return OK;
+  range->start = time_time(start);
+  range->stop = range->start + seconds;
 }
 
 status time_range_parse(a_time_range *range, const char *s, size_t len)
@@ -73,33 +66,44 @@ status time_range_parse(a_time_range *range, const char *s, size_t len)
   if (!dash)
     return NO;
   size_t dash_offset = dash - s;
-  if (len <= dash_offset)
+  if (THYME_STR_SIZE != dash_offset)
     return NO;
-  NOD(time_parse(&range->start, s, dash_offset));
-  len -= dash_offset - 1;
+  a_time start, stop;
+  NOD(time_parse(&start, s, dash_offset));
+  len -= dash_offset + 1;
   s += dash_offset + 1;
-  NOD(time_parse(&range->stop, s, len));
-  NOD(time_range_verify(range));
+  if (THYME_STR_SIZE != len)
+    return NO;
+  NOD(time_parse(&stop, s, len));
+  if (0 <= time_cmp(&start, &stop))
+    return NO;
+  range->start = time_time(&start);
+  range->stop = time_time(&stop);
   return OK;
 }
 
+/* In the local zone, which ranges are parsed in; see tz_local. */
 size_t time_range_to_s(const a_time_range *range, char *buffer)
 {
+  a_time t;
   size_t offset = 0;
-  offset += time_to_s(&range->start, &buffer[offset]);
+  time_init(&t, (time_t)range->start);
+  offset += time_to_s(&t, &buffer[offset]);
   buffer[offset++] = '-';
-  offset += time_to_s(&range->stop, &buffer[offset]);
+  time_init(&t, (time_t)range->stop);
+  offset += time_to_s(&t, &buffer[offset]);
   return offset;
 }
 
-a_remaining_result time_range_remaining(a_time_range *range, a_time *t)
+a_remaining_result time_range_remaining(const a_time_range *range, const a_time *t)
 {
-  int until_stop = time_diff(&range->stop, t);
+  int64_t time = time_time(t);
+  int until_stop = (int)(range->stop - time);
   if (until_stop <= 0) {
     a_remaining_result result = { 1, 0, 0 };
     return result;
   }
-  int until_start = time_diff(&range->start, t);
+  int until_start = (int)(range->start - time);
   if (until_start <= 0) {
     a_remaining_result result = { 1, 1, until_stop };
     return result;
@@ -139,8 +143,9 @@ void test_time_range_merge(void)
   a_time_range src;
   time_range_init(&src, &later, 10);
   time_range_merge(&dest, &src);
-  if (0 != time_cmp(&dest.start, now)) TFAIL();
-  if (0 != time_cmp(&dest.stop, &src.stop)) TFAIL();
+  if (time_time(now) != dest.start) TFAIL();
+  if (src.stop != dest.stop) TFAIL();
+  if (16 != sizeof(a_time_range)) TFAIL();
 }
 
 char *time_range_to_s_dup(a_time_range *range)
@@ -175,6 +180,8 @@ void test_time_range_parse(void)
   BAD("20150101010200-20150101010200");
   BAD("20150101010200-20150101016000");
   BAD("20150101010100-2015010101000");
+  BAD("20150101010100X-20150101010200");
+  BAD("201501010101000-20150101010200");
 #undef BAD
 }
 
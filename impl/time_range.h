@@ -3,24 +3,30 @@
 
 #include "time.h"
 #include "remaining.h"
+#include <stdint.h>
 
 #define TIME_RANGE_STR_SIZE (2 * THYME_STR_SIZE + 1)
 
+/*
+ * A range of times, [start, stop), in seconds since the epoch.  Ranges
+ * hold no civil time, which is worked out from an a_time where it's
+ * needed, so that a range is 16 bytes.
+ */
 typedef struct a_time_range {
-  a_time start;
-  a_time stop;
+  int64_t start;
+  int64_t stop;
 } a_time_range;
 
 a_time_range time_range_empty(void);
-bool time_range_contains(a_time_range *range, const a_time *t);
+bool time_range_contains(const a_time_range *range, const a_time *t);
 void time_range_init(a_time_range *range, const a_time *start, int seconds);
-void time_range_copy(a_time_range *dest, a_time_range *src);
-void time_range_merge(a_time_range *dest, a_time_range *src);
-a_time_range *time_range_overlap_alloc(a_time_range *range,
-                                       a_time_range *during);
-bool time_range_overlaps_or_abuts(a_time_range *a, a_time_range *b);
+void time_range_copy(a_time_range *dest, const a_time_range *src);
+void time_range_merge(a_time_range *dest, const a_time_range *src);
+a_time_range *time_range_overlap_alloc(const a_time_range *range,
+                                       const a_time_range *during);
+bool time_range_overlaps_or_abuts(const a_time_range *a, const a_time_range *b);
 status time_range_parse(a_time_range *range, const char *s, size_t len);
 size_t time_range_to_s(const a_time_range *range, char *buffer);
-a_remaining_result time_range_remaining(a_time_range *range, a_time *t);
+a_remaining_result time_range_remaining(const a_time_range *range, const a_time *t);
 
 #endif /* __time_range_h__ */
@@ -0,0 +1,913 @@
+#ifndef __tz_c__
+#define __tz_c__
+
+/*
+ * Recommended reading:
+ *
+ * https://www.rfc-editor.org/rfc/rfc8536 (TZif)
+ * https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap08.html (TZ)
+ * http://howardhinnant.github.io/date_algorithms.html
+ */
+
+#include "impl.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TZ_NONE INT64_MIN
+#define TZ_NEVER INT64_MAX
+
+/* Days since 1970-01-01 of a proleptic Gregorian date. */
+int64_t tz_days_from_civil(int64_t year, int mon, int mday)
+{
+  year -= mon <= 2;
+  int64_t era = (0 <= year ? year : year - 399) / 400;
+  int64_t yoe = year - era * 400;
+  int64_t doy = (153 * (mon + (2 < mon ? -3 : 9)) + 2) / 5 + mday - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static void tz_civil_from_days(int64_t days, int64_t *year, int *mon, int *mday)
+{
+  days += 719468;
+  int64_t era = (0 <= days ? days : days - 146096) / 146097;
+  int64_t doe = days - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  *mday = (int)(doy - (153 * mp + 2) / 5 + 1);
+  *mon = (int)(mp < 10 ? mp + 3 : mp - 9);
+  *year = yoe + era * 400 + (*mon <= 2);
+}
+
+static int64_t tz_floor_div(int64_t a, int64_t b)
+{
+  return (a - (a < 0 ? b - 1 : 0)) / b;
+}
+
+static bool tz_is_leap_year(int64_t year)
+{
+  return 0 == year % 4 && (0 != year % 100 || 0 == year % 400);
+}
+
+/* The local time when rule takes effect in year, as seconds since 1970. */
+static int64_t tz_rule_local(const a_tz_rule *rule, int64_t year)
+{
+  int64_t days = tz_days_from_civil(year, 1, 1);
+  switch (rule->kind) {
+  case 'J':
+    days += rule->day - 1;
+    if (59 < rule->day && tz_is_leap_year(year))
+      days += 1;
+    break;
+  case 'D':
+    days += rule->day;
+    break;
+  default: {
+    int64_t first = tz_days_from_civil(year, rule->mon, 1);
+    int64_t next = 12 == rule->mon ?
+      tz_days_from_civil(year + 1, 1, 1) :
+      tz_days_from_civil(year, rule->mon + 1, 1);
+    int first_wday = (int)((first % 7 + 11) % 7); /* 1970-01-01 is a Thursday */
+    days = first + (rule->wday - first_wday + 7) % 7 + 7 * (rule->week - 1);
+    while (next <= days)
+      days -= 7;
+  }
+  }
+  return days * 86400 + rule->time;
+}
+
+static int64_t tz_posix_year(const a_tz_posix *posix, int64_t t)
+{
+  int64_t year;
+  int mon, mday;
+  tz_civil_from_days(tz_floor_div(t + posix->std.utoff, 86400), &year, &mon, &mday);
+  return year;
+}
+
+static int64_t tz_posix_start(const a_tz_posix *posix, int64_t year)
+{
+  return tz_rule_local(&posix->start, year) - posix->std.utoff;
+}
+
+static int64_t tz_posix_end(const a_tz_posix *posix, int64_t year)
+{
+  return tz_rule_local(&posix->end, year) - posix->dst.utoff;
+}
+
+static a_tz_type tz_posix_type_at(const a_tz_posix *posix, int64_t t)
+{
+  if (!posix->has_dst)
+    return posix->std;
+  int64_t year = tz_posix_year(posix, t);
+  int64_t start = tz_posix_start(posix, year);
+  int64_t end = tz_posix_end(posix, year);
+  bool isdst = start < end ?
+    start <= t && t < end :   /* northern hemisphere */
+    t < end || start <= t;    /* southern hemisphere */
+  return isdst ? posix->dst : posix->std;
+}
+
+static int64_t tz_posix_next_transition(const a_tz_posix *posix, int64_t t)
+{
+  if (!posix->has_dst)
+    return TZ_NEVER;
+  int64_t next = TZ_NEVER;
+  int64_t year = tz_posix_year(posix, t);
+  int64_t y = year - 1;
+  for (; y <= year + 1; ++y) {
+    int64_t start = tz_posix_start(posix, y);
+    int64_t end = tz_posix_end(posix, y);
+    if (t < start && start < next)
+      next = start;
+    if (t < end && end < next)
+      next = end;
+  }
+  return next;
+}
+
+/* The index of the first transition after t. */
+static int tz_upper_bound(const a_tz *tz, int64_t t)
+{
+  int lo = 0, hi = tz->n_transitions;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (tz->transitions[mid] <= t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static a_tz_type tz_type_at(const a_tz *tz, int64_t t)
+{
+  int i = tz_upper_bound(tz, t);
+  if (i == tz->n_transitions && tz->has_posix)
+    return tz_posix_type_at(&tz->posix, t);
+  if (0 == i)
+    return tz->types[0];
+  return tz->types[tz->types_at[i - 1]];
+}
+
+/* The first change of UTC offset after t, or INT64_MAX if there is none. */
+int64_t tz_next_transition(const a_tz *tz, int64_t t)
+{
+  int i = tz_upper_bound(tz, t);
+  if (i < tz->n_transitions)
+    return tz->transitions[i];
+  if (tz->has_posix)
+    return tz_posix_next_transition(&tz->posix, t);
+  return TZ_NEVER;
+}
+
+/*
+ * Find the time whose local time is 'local'.  Like glibc's mktime
+ * with tm_isdst of -1, a local time that occurs twice is the later
+ * one, and a local time that is skipped is read with the offset from
+ * one side of the skip so that the result is in daylight saving time,
+ * e.g., 2:30 on the day PST springs forward is 3:30 PDT.  Offsets are
+ * less than 26 hours, so only the transitions within a day or so of
+ * 'local' matter.
+ */
+static int64_t tz_local_to_time(const a_tz *tz, int64_t local)
+{
+  const int64_t window = 27 * 3600;
+  int64_t start = local - window;
+  int64_t found = TZ_NONE;
+  int64_t skipped = TZ_NONE;
+  a_tz_type before = { 0, false };
+  bool is_transition = false;
+  for (;;) {
+    a_tz_type type = tz_type_at(tz, start);
+    int64_t end = tz_next_transition(tz, start);
+    int64_t t = local - type.utoff;
+    if (start <= t && t < end)
+      found = t;
+    else if (is_transition && TZ_NONE == skipped &&
+             start + before.utoff <= local && local < start + type.utoff)
+      skipped = before.isdst && !type.isdst ?
+        local - type.utoff :    /* lands before the transition */
+        local - before.utoff;   /* lands after it */
+    if (local + window < end)
+      break;
+    before = type;
+    is_transition = true;
+    start = end;
+  }
+  return TZ_NONE != found ? found : skipped;
+}
+
+void tz_localtime(const a_tz *tz, time_t time, struct tm *tm)
+{
+  STATS_INCR(STAT_LOCALTIMES);
+  if (!tz) {
+    LOCALTIME_R(&time, tm);
+    return;
+  }
+  a_tz_type type = tz_type_at(tz, time);
+  int64_t local = (int64_t)time + type.utoff;
+  int64_t days = tz_floor_div(local, 86400);
+  int secs = (int)(local - days * 86400);
+  int64_t year;
+  int mon, mday;
+  tz_civil_from_days(days, &year, &mon, &mday);
+  memset(tm, 0, sizeof(struct tm));
+  tm->tm_sec = secs % 60;
+  tm->tm_min = secs / 60 % 60;
+  tm->tm_hour = secs / 3600;
+  tm->tm_mday = mday;
+  tm->tm_mon = mon - 1;
+  tm->tm_year = (int)(year - 1900);
+  tm->tm_wday = (int)((days % 7 + 11) % 7);
+  tm->tm_yday = (int)(days - tz_days_from_civil(year, 1, 1));
+  tm->tm_isdst = type.isdst;
+}
+
+/*
+ * Like mktime with tm_isdst of -1.  Out of range fields in tm are
+ * normalized, and tm is set to the resulting local time.
+ */
+time_t tz_mktime(const a_tz *tz, struct tm *tm)
+{
+  STATS_INCR(STAT_MKTIMES);
+  if (!tz)
+    return mktime(tm);
+  int64_t mon = tm->tm_mon;
+  int64_t year = 1900 + (int64_t)tm->tm_year + tz_floor_div(mon, 12);
+  mon -= 12 * tz_floor_div(mon, 12);
+  int64_t days = tz_days_from_civil(year, (int)mon + 1, 1) + tm->tm_mday - 1;
+  int64_t local = days * 86400 +
+    (int64_t)tm->tm_hour * 3600 + (int64_t)tm->tm_min * 60 + tm->tm_sec;
+  int64_t t = tz_local_to_time(tz, local);
+  if (TZ_NONE == t || t != (time_t)t)
+    return -1;
+  tz_localtime(tz, (time_t)t, tm);
+  return (time_t)t;
+}
+
+static uint32_t tz_be32(const unsigned char *p)
+{
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static int64_t tz_be64(const unsigned char *p)
+{
+  return (int64_t)((uint64_t)tz_be32(p) << 32 | tz_be32(p + 4));
+}
+
+static const char *tz_parse_abbreviation(const char *s)
+{
+  if ('<' == *s) {
+    s = strchr(s, '>');
+    return s ? s + 1 : 0;
+  }
+  const char *end = s;
+  while (('a' <= *end && *end <= 'z') || ('A' <= *end && *end <= 'Z'))
+    ++end;
+  return 3 <= end - s ? end : 0;
+}
+
+/* [+-]hh[:mm[:ss]] */
+static const char *tz_parse_hms(const char *s, int32_t *out)
+{
+  int sign = 1;
+  if ('+' == *s || '-' == *s)
+    sign = '-' == *s++ ? -1 : 1;
+  if (*s < '0' || '9' < *s)
+    return 0;
+  int32_t hms = 0, unit = 3600;
+  for (;;) {
+    int32_t n = 0;
+    for (; '0' <= *s && *s <= '9'; ++s)
+      n = 10 * n + (*s - '0');
+    if (167 < n)
+      return 0;
+    hms += n * unit;
+    if (':' != *s || 1 == unit)
+      break;
+    ++s;
+    unit /= 60;
+  }
+  *out = sign * hms;
+  return s;
+}
+
+static const char *tz_parse_rule(const char *s, a_tz_rule *rule)
+{
+  memset(rule, 0, sizeof(a_tz_rule));
+  char *end;
+  if ('M' == *s) {
+    rule->kind = 'M';
+    rule->mon = (int)strtol(s + 1, &end, 10);
+    if ('.' != *end) return 0;
+    rule->week = (int)strtol(end + 1, &end, 10);
+    if ('.' != *end) return 0;
+    rule->wday = (int)strtol(end + 1, &end, 10);
+    if (rule->mon < 1 || 12 < rule->mon || rule->week < 1 || 5 < rule->week ||
+        rule->wday < 0 || 6 < rule->wday)
+      return 0;
+  } else {
+    rule->kind = 'J' == *s ? 'J' : 'D';
+    if ('J' == *s)
+      ++s;
+    if (*s < '0' || '9' < *s)
+      return 0;
+    rule->day = (int)strtol(s, &end, 10);
+    if (('J' == rule->kind && (rule->day < 1 || 365 < rule->day)) || 365 < rule->day)
+      return 0;
+  }
+  s = end;
+  rule->time = 2 * 3600;
+  if ('/' == *s)
+    s = tz_parse_hms(s + 1, &rule->time);
+  return s;
+}
+
+/*
+ * E.g., "PST8PDT,M3.2.0,M11.1.0".  POSIX offsets are west of UTC.
+ * Without a rule, assume the US rule, as glibc does.
+ */
+static status tz_parse_posix(const char *s, a_tz_posix *posix)
+{
+  memset(posix, 0, sizeof(a_tz_posix));
+  int32_t offset;
+  if (!(s = tz_parse_abbreviation(s)) || !(s = tz_parse_hms(s, &offset)))
+    return NO;
+  posix->std.utoff = -offset;
+  if (!*s)
+    return OK;
+  if (!(s = tz_parse_abbreviation(s)))
+    return NO;
+  posix->has_dst = true;
+  posix->dst.isdst = true;
+  posix->dst.utoff = posix->std.utoff + 3600;
+  if (*s && ',' != *s) {
+    if (!(s = tz_parse_hms(s, &offset)))
+      return NO;
+    posix->dst.utoff = -offset;
+  }
+  if (!*s)
+    s = ",M3.2.0,M11.1.0";
+  if (',' != *s || !(s = tz_parse_rule(s + 1, &posix->start)))
+    return NO;
+  if (',' != *s || !(s = tz_parse_rule(s + 1, &posix->end)))
+    return NO;
+  return *s ? NO : OK;
+}
+
+/* Parse TZif data, preferring the 64-bit data of version 2 and later. */
+static status tz_parse_tzif(a_tz *tz, const unsigned char *p, size_t len)
+{
+  const unsigned char *end = p + len;
+  int time_size = 4;
+  for (;;) {
+    if (end - p < 44 || memcmp(p, "TZif", 4))
+      return NO;
+    bool has_v2 = p[4] && 4 == time_size;
+    uint32_t isutcnt = tz_be32(p + 20), isstdcnt = tz_be32(p + 24);
+    uint32_t leapcnt = tz_be32(p + 28), timecnt = tz_be32(p + 32);
+    uint32_t typecnt = tz_be32(p + 36), charcnt = tz_be32(p + 40);
+    p += 44;
+    size_t size = (size_t)timecnt * (time_size + 1) + (size_t)typecnt * 6 +
+      charcnt + (size_t)leapcnt * (time_size + 4) + isstdcnt + isutcnt;
+    if ((size_t)(end - p) < size)
+      return NO;
+    if (has_v2) {
+      p += size;
+      time_size = 8;
+      continue;
+    }
+    if (leapcnt || !typecnt || 256 < typecnt)
+      return NO; /* libc knows leap seconds */
+    tz->n_transitions = (int)timecnt;
+    tz->transitions = malloc(sizeof(int64_t) * (timecnt ? timecnt : 1));
+    tz->types_at = malloc(timecnt ? timecnt : 1);
+    tz->n_types = (int)typecnt;
+    tz->types = malloc(sizeof(a_tz_type) * typecnt);
+    if (!tz->transitions || !tz->types_at || !tz->types)
+      return NO;
+    uint32_t i = 0;
+    for (; i < timecnt; ++i, p += time_size)
+      tz->transitions[i] = 8 == time_size ? tz_be64(p) : (int32_t)tz_be32(p);
+    for (i = 0; i < timecnt; ++i, ++p) {
+      if (typecnt <= *p)
+        return NO;
+      tz->types_at[i] = *p;
+    }
+    for (i = 0; i < typecnt; ++i, p += 6) {
+      tz->types[i].utoff = (int32_t)tz_be32(p);
+      tz->types[i].isdst = p[4] ? true : false;
+    }
+    p += charcnt + isstdcnt + isutcnt;
+    break;
+  }
+  /* The footer is a newline, a POSIX TZ string, and a newline. */
+  if (8 == time_size && p < end && '\n' == *p) {
+    const unsigned char *nl = memchr(p + 1, '\n', end - p - 1);
+    if (!nl)
+      return NO;
+    if (p + 1 < nl) {
+      char footer[0x100];
+      if (sizeof(footer) <= (size_t)(nl - p - 1))
+        return NO;
+      memcpy(footer, p + 1, nl - p - 1);
+      footer[nl - p - 1] = 0;
+      NOD(tz_parse_posix(footer, &tz->posix));
+      tz->has_posix = true;
+    }
+  }
+  return OK;
+}
+
+/* TZif files are a few kilobytes, so anything this big isn't one. */
+#define TZ_MAX_FILE_SIZE 0x40000
+
+static status tz_load_file(a_tz *tz, const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return NO;
+  size_t cap = 0x1000, len = 0;
+  unsigned char *data = malloc(cap);
+  for (; data;) {
+    len += fread(data + len, 1, cap - len, f);
+    if (len < cap)
+      break;
+    if (TZ_MAX_FILE_SIZE <= cap) {
+      free(data);
+      data = 0;
+      break;
+    }
+    cap *= 2;
+    unsigned char *grown = realloc(data, cap);
+    if (!grown)
+      free(data);
+    data = grown;
+  }
+  fclose(f);
+  if (!data)
+    return NO;
+  status ret = tz_parse_tzif(tz, data, len);
+  free(data);
+  return ret;
+}
+
+/* Free what a zone holds, for one that failed to load. */
+static void tz_clear(a_tz *tz)
+{
+  free(tz->transitions);
+  free(tz->types_at);
+  free(tz->types);
+  tz->n_transitions = 0;
+  tz->transitions = 0;
+  tz->types_at = 0;
+  tz->n_types = 0;
+  tz->types = 0;
+  tz->has_posix = false;
+}
+
+/* Load name, a file under $TZDIR or /usr/share/zoneinfo. */
+static status tz_load_zoneinfo(a_tz *tz, const char *name)
+{
+  const char *dir = getenv("TZDIR");
+  if (!dir || !*dir)
+    dir = "/usr/share/zoneinfo";
+  size_t dir_len = strlen(dir), name_len = strlen(name);
+  char *path = malloc(dir_len + name_len + 2);
+  if (!path)
+    return NO;
+  memcpy(path, dir, dir_len);
+  path[dir_len] = '/';
+  memcpy(path + dir_len + 1, name, name_len + 1);
+  status ret = tz_load_file(tz, path);
+  free(path);
+  if (OK != ret)
+    tz_clear(tz);
+  tz->is_zoneinfo = OK == ret ? true : false;
+  return ret;
+}
+
+/*
+ * Load the zone for a value of TZ the way glibc does: unset is
+ * /etc/localtime, a leading ':' is ignored, and a name is a file
+ * under $TZDIR or /usr/share/zoneinfo unless it is absolute.  If there
+ * is no such file, TZ may be a POSIX TZ string.
+ */
+static status tz_load(a_tz *tz, const char *name)
+{
+  if (!name)
+    return tz_load_file(tz, "/etc/localtime");
+  if (':' == *name)
+    ++name;
+  if (!*name)
+    return NO; /* UTC, but leave it to libc */
+  if ('/' == *name)
+    return tz_load_file(tz, name);
+  if (!strstr(name, "..") && OK == tz_load_zoneinfo(tz, name))
+    return OK;
+  NOD(tz_parse_posix(name, &tz->posix));
+  tz->has_posix = true;
+  tz->n_types = 1;
+  tz->types = malloc(sizeof(a_tz_type));
+  if (!tz->types)
+    return NO;
+  tz->types[0] = tz->posix.std;
+  return OK;
+}
+
+static bool tz_is_named(const a_tz *tz, const char *name)
+{
+  if (!tz->name || !name)
+    return tz->name == name ? true : false;
+  return 0 == strcmp(tz->name, name) ? true : false;
+}
+
+static a_mutex tz_mutex = MUTEX_INITIALIZER;
+static a_tz *tz_registry;
+
+/*
+ * tz_get returns the zone for a value of TZ, where null means unset,
+ * loading it the first time.  It returns null if the zone can't be
+ * loaded, meaning use libc, and always on Windows.  Every value is
+ * kept, loaded or not, since TZ comes from the process itself; zones
+ * named by callers go through tz_get_zone.
+ */
+const a_tz *tz_get(const char *name)
+{
+#if _WIN32
+  (void)name;
+  return 0;
+#else
+  a_tz *tz = ATOMIC_LOAD(&tz_registry);
+  for (; tz; tz = tz->next)
+    if (tz_is_named(tz, name))
+      return tz->is_valid ? tz : 0;
+  MUTEX_LOCK(&tz_mutex);
+  for (tz = tz_registry; tz; tz = tz->next)
+    if (tz_is_named(tz, name))
+      break;
+  if (!tz) {
+    /* without memory, use libc this time and try again next time */
+    tz = calloc(1, sizeof(a_tz));
+    if (tz && name && !(tz->name = malloc(strlen(name) + 1))) {
+      free(tz);
+      tz = 0;
+    }
+    if (!tz) {
+      MUTEX_UNLOCK(&tz_mutex);
+      return 0;
+    }
+    if (name)
+      strcpy(tz->name, name);
+    tz->is_valid = OK == tz_load(tz, name) ? true : false;
+    if (!tz->is_valid)
+      tz_clear(tz);
+    tz->next = tz_registry;
+    ATOMIC_STORE(&tz_registry, tz);
+  }
+  MUTEX_UNLOCK(&tz_mutex);
+  return tz->is_valid ? tz : 0;
+#endif
+}
+
+/*
+ * A zone named by a caller rather than by TZ must be a name in the
+ * zoneinfo directory, such as "America/Chicago" or "Etc/GMT+5": not a
+ * path of its own, and not one that climbs out of it.
+ */
+static bool tz_is_zone_name(const char *name)
+{
+  if (!name || !*name || '/' == *name || strstr(name, ".."))
+    return false;
+  size_t len = 0;
+  for (; name[len]; ++len)
+    if (!isalnum((unsigned char)name[len]) && !strchr("/_-+.", name[len]))
+      return false;
+  return len < 0x100 ? true : false;
+}
+
+/*
+ * tz_get_zone returns the zone named by a caller, from the zoneinfo
+ * directory, or null if there's no such zone.  Unlike tz_get, it keeps
+ * only zones that load, so that names that don't can't fill the
+ * registry.
+ */
+const a_tz *tz_get_zone(const char *name)
+{
+#if _WIN32
+  (void)name;
+  return 0;
+#else
+  if (!tz_is_zone_name(name))
+    return 0;
+  a_tz *tz = ATOMIC_LOAD(&tz_registry);
+  for (; tz; tz = tz->next)
+    if (tz->is_zoneinfo && tz_is_named(tz, name))
+      return tz;
+  MUTEX_LOCK(&tz_mutex);
+  for (tz = tz_registry; tz; tz = tz->next)
+    if (tz->is_zoneinfo && tz_is_named(tz, name))
+      break;
+  if (!tz && (tz = calloc(1, sizeof(a_tz)))) {
+    tz->name = malloc(strlen(name) + 1);
+    if (tz->name && OK == tz_load_zoneinfo(tz, name)) {
+      strcpy(tz->name, name);
+      tz->is_valid = true;
+      tz->next = tz_registry;
+      ATOMIC_STORE(&tz_registry, tz);
+    } else {
+      free(tz->name);
+      free(tz);
+      tz = 0;
+    }
+  }
+  MUTEX_UNLOCK(&tz_mutex);
+  return tz;
+#endif
+}
+
+static THREAD_LOCAL const a_tz *tz_local_override;
+
+/*
+ * The zone for the current value of TZ, unless tz_set_local has set
+ * one for this thread.
+ */
+#if _WIN32
+/*
+ * http://cygwin.1069669.n5.nabble.com/Re-PATCH-Setting-TZ-may-break-time-in-non-Cygwin-programs-tt90762.html
+ * Done before TZ is first read rather than at load time.
+ */
+static void tz_cygwin_fix(void)
+{
+  static bool is_fixed;
+  if (is_fixed)
+    return;
+  is_fixed = true;
+  const char *tz = getenv("TZ");
+  if (!tz || strlen(tz) < 5)
+    return;
+  if ('0' <= tz[3] && tz[3] <= '9')
+    return;
+  if ('0' <= tz[4] && tz[4] <= '9' && ('-' == tz[3] || '+' == tz[3]))
+    return;
+  _putenv("TZ=");
+}
+#endif
+
+const a_tz *tz_local(void)
+{
+  static THREAD_LOCAL const a_tz *last;
+  if (tz_local_override)
+    return tz_local_override;
+#if _WIN32
+  tz_cygwin_fix();
+#endif
+  const char *name = getenv("TZ");
+  if (last && tz_is_named(last, name))
+    return last->is_valid ? last : 0;
+  const a_tz *tz = tz_get(name);
+  if (tz)
+    last = tz;
+  return tz;
+}
+
+/*
+ * Make tz_local return tz on this thread, or go back to TZ if tz is
+ * null, and return the previous setting.  This lets one thread work
+ * in a zone without touching TZ, which other threads share.
+ */
+const a_tz *tz_set_local(const a_tz *tz)
+{
+  const a_tz *was = tz_local_override;
+  tz_local_override = tz;
+  return was;
+}
+
+#if RUN_TESTS
+#if !_WIN32
+static bool tz_tm_eq(const struct tm *a, const struct tm *b)
+{
+  return (a->tm_sec == b->tm_sec && a->tm_min == b->tm_min &&
+          a->tm_hour == b->tm_hour && a->tm_mday == b->tm_mday &&
+          a->tm_mon == b->tm_mon && a->tm_year == b->tm_year &&
+          a->tm_wday == b->tm_wday && a->tm_yday == b->tm_yday &&
+          a->tm_isdst == b->tm_isdst) ? true : false;
+}
+
+static void test_tz_localtime_at(const a_tz *tz, time_t t)
+{
+  struct tm expected, actual;
+  localtime_r(&t, &expected);
+  tz_localtime(tz, t, &actual);
+  if (!tz_tm_eq(&expected, &actual))
+    TFAILF(" %s at %ld: %d:%d vs %d:%d", tz->name, (long)t,
+           expected.tm_hour, expected.tm_min, actual.tm_hour, actual.tm_min);
+}
+
+/*
+ * Compare with mktime, except for local times that occur twice, where
+ * glibc's answer depends on earlier calls.
+ */
+static void test_tz_mktime_at(const a_tz *tz, time_t t)
+{
+  struct tm local, expected, actual;
+  localtime_r(&t, &local);
+  local.tm_min += 7; /* land in gaps, too */
+  local.tm_isdst = -1;
+  expected = actual = local;
+  time_t tt = mktime(&expected);
+  int dt = -3600;
+  for (; dt <= 3600; dt += 1800) {
+    time_t other = tt + dt;
+    struct tm tm;
+    localtime_r(&other, &tm);
+    if (dt && tm.tm_hour == expected.tm_hour && tm.tm_min == expected.tm_min &&
+        tm.tm_mday == expected.tm_mday)
+      return;
+  }
+  if (tt != tz_mktime(tz, &actual) || !tz_tm_eq(&expected, &actual))
+    TFAILF(" %s at %ld: %ld vs %ld", tz->name, (long)t, (long)tt,
+           (long)tz_mktime(tz, &actual));
+}
+
+static void test_tz_matches_libc(void)
+{
+  const char *names[] = {
+    "America/Los_Angeles",
+    "Australia/Lord_Howe",
+    "Europe/Dublin",
+    "America/Santiago",
+    "Asia/Kolkata",
+    "UTC",
+    "PST8PDT,M3.2.0,M11.1.0",
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+  };
+  const int near[] = {
+    -3601, -3600, -3599, -1801, -1800, -1799, -61, -1,
+    0, 1, 59, 1799, 1800, 1801, 3599, 3600, 3601,
+  };
+  const char *old = getenv("TZ");
+  char *saved = old ? strcpy(malloc(strlen(old) + 1), old) : 0;
+  size_t i = 0;
+  for (; i < DIM(names); ++i) {
+    const a_tz *tz = tz_get(names[i]);
+    if (!tz)
+      continue; /* not installed */
+    setenv("TZ", names[i], 1);
+    tzset();
+    if (tz != tz_local()) TFAIL();
+    /*
+     * Every transition, and a sample of days in between.  glibc
+     * applies a bare POSIX rule to years before 1970 as if they were
+     * 1970, so skip those.
+     */
+    time_t t = tz->n_transitions ? -1000000000 : 86400 * 366;
+    while (t < 3000000000) {
+      int64_t next = tz_next_transition(tz, t);
+      for (; t < next && t < 3000000000; t += 86400 * 5 + 3601) {
+        test_tz_localtime_at(tz, t);
+        test_tz_mktime_at(tz, t);
+      }
+      if (3000000000 <= next)
+        break;
+      size_t j = 0;
+      for (; j < DIM(near); ++j) {
+        test_tz_localtime_at(tz, next + near[j]);
+        test_tz_mktime_at(tz, next + near[j]);
+      }
+      t = next + 3602;
+    }
+  }
+  if (saved) {
+    setenv("TZ", saved, 1);
+    free(saved);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+static size_t test_tz_registry_size(void)
+{
+  size_t n = 0;
+  const a_tz *tz = tz_registry;
+  for (; tz; tz = tz->next)
+    ++n;
+  return n;
+}
+
+static void test_tz_get_zone(void)
+{
+  const a_tz *utc = tz_get_zone("UTC");
+  if (!utc)
+    return; /* no zoneinfo */
+  if (utc != tz_get_zone("UTC") || !utc->is_zoneinfo) TFAIL();
+  size_t n = test_tz_registry_size();
+  const char *names[] = {
+    "", "/usr/share/zoneinfo/UTC", "../zoneinfo/UTC", "Etc/../UTC", ":UTC",
+    "/dev/zero", "EST5", "PST8PDT,M3.2.0,M11.1.0", "Not/AZone", "UTC\n",
+  };
+  size_t i = 0;
+  for (; i < DIM(names); ++i)
+    if (tz_get_zone(names[i])) TFAILF(" %s", names[i]);
+  if (tz_get_zone(0)) TFAIL();
+  /* names that don't load aren't kept */
+  if (n != test_tz_registry_size()) TFAIL();
+  a_tz tz;
+  memset(&tz, 0, sizeof(a_tz));
+  if (OK == tz_load_file(&tz, "/dev/zero")) TFAIL();
+  tz_clear(&tz);
+}
+#endif /* !_WIN32 */
+
+static void test_tz_posix(void)
+{
+  a_tz_posix posix;
+#define X(S, OK_, STD, DST) do {                                        \
+    status ok = tz_parse_posix(S, &posix);                              \
+    if (OK_ != (OK == ok)) TFAILF(" %s", S);                            \
+    if (OK == ok && (STD != posix.std.utoff ||                          \
+                     (posix.has_dst && DST != posix.dst.utoff)))        \
+      TFAILF(" %s %d %d", S, posix.std.utoff, posix.dst.utoff);          \
+  } while_0
+  X("PST8PDT,M3.2.0,M11.1.0",               true,  -8 * 3600, -7 * 3600);
+  X("EST5EDT",                              true,  -5 * 3600, -4 * 3600);
+  X("<+1030>-10:30<+11>-11,M10.1.0,M4.1.0", true,  37800,     39600);
+  X("IST-1GMT0,M10.5.0,M3.5.0/1",           true,  3600,      0);
+  X("<-03>3",                               true,  -3 * 3600, 0);
+  X("UTC0",                                 true,  0,         0);
+  X("PST",                                  false, 0,         0);
+  X("PST8PDT,M13.2.0,M11.1.0",              false, 0,         0);
+  X("8",                                    false, 0,         0);
+#undef X
+  /* 2015-03-08 2:00 PST becomes 3:00 PDT, 2015-11-01 2:00 PDT becomes 1:00 PST */
+  tz_parse_posix("PST8PDT,M3.2.0,M11.1.0", &posix);
+  if (1425808800 != tz_posix_start(&posix, 2015)) TFAIL();
+  if (1446368400 != tz_posix_end(&posix, 2015)) TFAIL();
+  if (1425808800 != tz_posix_next_transition(&posix, 1420070400)) TFAIL();
+  if (1446368400 != tz_posix_next_transition(&posix, 1425808800)) TFAIL();
+}
+
+static void test_tz_mktime(void)
+{
+  a_tz tz;
+  memset(&tz, 0, sizeof(a_tz));
+  tz_parse_posix("PST8PDT,M3.2.0,M11.1.0", &tz.posix);
+  tz.has_posix = true;
+  tz.n_types = 1;
+  tz.types = &tz.posix.std;
+  struct tm tm;
+#define X(Y, M, D, H, MIN, EXPECTED, HOUR, ISDST) do {                  \
+    memset(&tm, 0, sizeof(tm));                                         \
+    tm.tm_year = Y - 1900;                                              \
+    tm.tm_mon = M - 1;                                                  \
+    tm.tm_mday = D;                                                     \
+    tm.tm_hour = H;                                                     \
+    tm.tm_min = MIN;                                                    \
+    tm.tm_isdst = -1;                                                   \
+    time_t t = tz_mktime(&tz, &tm);                                     \
+    if (EXPECTED != t) TFAILF(" %ld", (long)t);                         \
+    if (HOUR != tm.tm_hour || ISDST != tm.tm_isdst) TFAIL();            \
+  } while_0
+  X(2015,  3,  8,  1, 30, 1425807000, 1, 0);
+  X(2015,  3,  8,  2, 30, 1425810600, 3, 1); /* skipped */
+  X(2015,  3,  8,  3, 30, 1425810600, 3, 1);
+  X(2015, 11,  1,  0, 30, 1446363000, 0, 1);
+  X(2015, 11,  1,  1, 30, 1446370200, 1, 0); /* twice, prefer PST */
+  X(2015, 11,  1,  2, 30, 1446373800, 2, 0);
+  X(2015, 10, 32, 24, 30, 1446370200 + 23 * 3600, 0, 0); /* normalized */
+#undef X
+  struct tm local;
+  tz_localtime(&tz, 1425810600, &local);
+  if (2015 - 1900 != local.tm_year || 2 != local.tm_mon || 8 != local.tm_mday ||
+      3 != local.tm_hour || 30 != local.tm_min || 0 != local.tm_wday ||
+      66 != local.tm_yday || 1 != local.tm_isdst)
+    TFAIL();
+}
+
+PRE_INIT(test_tz)
+{
+  test_tz_posix();
+  test_tz_mktime();
+#if !_WIN32
+  test_tz_matches_libc();
+  test_tz_get_zone();
+#endif
+}
+#endif /* RUN_TESTS */
+
+#if ONE_OBJ
+#include "main.c"
+#include "stats.c"
+#endif
+
+/*
+ * Local Variables:
+ * compile-command: "gcc -Wall -DTEST -g -o tz tz.c && ./tz"
+ * End:
+ */
+
+#endif /* __tz_c__ */
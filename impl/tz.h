@@ -0,0 +1,66 @@
+#ifndef __tz_h__
+#define __tz_h__
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * tz - Conversion between unix time and local civil time without
+ * libc.  glibc's mktime and localtime_r take a global lock on every
+ * call, so instead a zone's TZif file (see tzfile(5)) is loaded once
+ * and times are converted with a binary search over its transitions.
+ * Times after the last transition follow the POSIX TZ rule at the end
+ * of the file.
+ *
+ * Zones are loaded on first use and never freed.  A null a_tz means
+ * the zone could not be loaded, e.g., on Windows or for a zone with
+ * leap seconds, and then tz_localtime and tz_mktime call libc.
+ */
+
+typedef struct a_tz_type {
+  int32_t utoff; /* seconds east of UTC */
+  bool isdst;
+} a_tz_type;
+
+/* When a POSIX TZ rule switches to or from daylight saving time. */
+typedef struct a_tz_rule {
+  char kind; /* 'J' for Jn, 'D' for n, or 'M' for Mm.w.d */
+  int day;   /* Jn or n */
+  int mon;   /* Mm.w.d */
+  int week;
+  int wday;
+  int32_t time; /* seconds after local midnight */
+} a_tz_rule;
+
+typedef struct a_tz_posix {
+  a_tz_type std;
+  a_tz_type dst;
+  bool has_dst;
+  a_tz_rule start; /* in standard time */
+  a_tz_rule end;   /* in daylight saving time */
+} a_tz_posix;
+
+typedef struct a_tz {
+  struct a_tz *next;      /* in the registry of loaded zones */
+  char *name;             /* the TZ it was loaded for, null if TZ is unset */
+  bool is_valid;
+  bool is_zoneinfo;       /* loaded from a file in the zoneinfo directory */
+  int n_transitions;
+  int64_t *transitions;   /* sorted */
+  unsigned char *types_at; /* index into types from each transition on */
+  int n_types;
+  a_tz_type *types;
+  bool has_posix;
+  a_tz_posix posix;       /* after the last transition */
+} a_tz;
+
+const a_tz *tz_get(const char *name);
+const a_tz *tz_get_zone(const char *name);
+const a_tz *tz_local(void);
+const a_tz *tz_set_local(const a_tz *tz);
+int64_t tz_next_transition(const a_tz *tz, int64_t t);
+void tz_localtime(const a_tz *tz, time_t time, struct tm *tm);
+time_t tz_mktime(const a_tz *tz, struct tm *tm);
+int64_t tz_days_from_civil(int64_t year, int mon, int mday);
+
+#endif /* __tz_h__ */
@@ -59,6 +59,15 @@ char *strnchr(const char *s, size_t len, char c)
   return 0;
 }
 
+size_t strncount(const char *s, size_t len, char c)
+{
+  size_t n = 0;
+  const char *end = s + len;
+  for (; s < end; ++s)
+    n += c == *s;
+  return n;
+}
+
 #include <string.h>
 
 void remove_char(char *s, char c)
@@ -72,6 +81,18 @@ void remove_char(char *s, char c)
   }
 }
 
+/* 64-bit FNV-1a, which is stable across platforms and releases. */
+uint64_t hash_bytes(const char *s, size_t len)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  const char *end = s + len;
+  for (; s < end; ++s) {
+    hash ^= (unsigned char)*s;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 #if RUN_TESTS
 void test_beginning_of_day(void)
 {
@@ -94,10 +115,22 @@ void test_beginning_of_week(void)
   if (tm->tm_sec) TFAIL();
 }
 
+void test_hash_bytes(void)
+{
+#define X(S, HASH) do {                                               \
+    if (HASH != hash_bytes(S, sizeof(S) - 1)) TFAIL();                \
+  } while_0
+  X("", 0xcbf29ce484222325ULL);
+  X("a", 0xaf63dc4c8601ec8cULL);
+  X("foobar", 0x85944171f73967e8ULL);
+#undef X
+}
+
 PRE_INIT(test_util)
 {
   test_beginning_of_day();
   test_beginning_of_week();
+  test_hash_bytes();
 }
 
 #if ONE_OBJ
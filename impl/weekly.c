@@ -11,6 +11,7 @@
 #define THURSDAY (1 << 4)
 #define FRIDAY (1 << 5)
 #define SATURDAY (1 << 6)
+#define WEEKDAYS (MONDAY | TUESDAY | WEDNESDAY | THURSDAY | FRIDAY)
 
 typedef struct day_descriptor {
   char c;
@@ -55,75 +56,56 @@ static size_t gobble_days(const char *s, size_t len, a_day_mask *mask)
   return n_gobbled;
 }
 
+/* The ranges of all days are one allocation; see day_from_minutes. */
 void week_destroy(a_week *week)
 {
   if (!week) return;
-  size_t i = 0;
-  for (; i < DIM(week->days); ++i) {
-    day_destroy(&week->days[i]);
-  }
-}
-
-void week_merge(a_week *dest, a_week *src)
-{
-  size_t i = 0;
-  for (; i < DIM(src->days); ++i) {
-    a_day *day = &src->days[i];
-    if (day->ranges) {
-      if (dest->days[i].ranges) {
-        day_merge(&dest->days[i], day);
-        day_destroy(day);
-      } else {
-        day_copy(&dest->days[i], day);
-        day->ranges = 0;
-      }
-    }
-  }
+  day_destroy(&week->days[0]);
+  memset(week, 0, sizeof(a_week));
 }
 
-/* MWF10-12 */
-status week_parse_single(a_week *week, const char *s, size_t len)
+/* MWF10-12.T8-9 */
+status week_init(a_week *week, const char *s, size_t len)
 {
-  if (week)
-    memset(week, 0, sizeof(a_week));
-  a_day_mask mask;
-  size_t offset = gobble_days(s, len, &mask);
-  if (0 == offset)
-    return NO;
-  s += offset;
-  len -= offset;
-  a_day day;
-  NOD(day_init(&day, s, len));
+  uint64_t words[DAY_MINUTES_WORDS];
+  a_bitmap minutes;
   if (week) {
-    size_t i = 0;
-    for (; i < DIM(day_descriptors); ++i) {
-      if (mask & day_descriptors[i].mask_bit) {
-        day_clone(&week->days[i], &day);
-      }
-    }
+    memset(week, 0, sizeof(a_week));
+    day_minutes_init(&minutes, words, DIM(week->days));
   }
-  day_destroy(&day);
+  const char *end = s + len;
+  for (;;) {
+    const char *period = strnchr(s, end - s, '.');
+    const char *stop = period ? period : end;
+    a_day_mask mask;
+    size_t offset = gobble_days(s, stop - s, &mask);
+    if (0 == offset)
+      return NO;
+    NOD(day_parse_minutes(week ? &minutes : 0, mask, s + offset, stop - s - offset));
+    if (!period)
+      break;
+    s = period + 1;
+  }
+  if (week && !day_from_minutes(week->days, DIM(week->days), &minutes))
+    return NO;
   return OK;
 }
 
-/* MWF10-12.T8-9 */
-status week_init(a_week *week, const char *s, size_t len)
+/* P9-17, which is MTWRF9-17 */
+status week_init_weekdaily(a_week *week, const char *s, size_t len)
 {
-  const char *period = strnchr(s, len, '.');
-  if (period) {
-    size_t offset = period - s;
-    NOD(week_parse_single(week, s, offset));
-    s += offset + 1;
-    len -= offset + 1;
-    a_week rest;
-    NOD(week_init(week ? &rest : 0, s, len));
-    if (week) {
-      week_merge(week, &rest);
-      week_destroy(&rest);
-    }
-    return OK;
+  uint64_t words[DAY_MINUTES_WORDS];
+  a_bitmap minutes;
+  if (week) {
+    memset(week, 0, sizeof(a_week));
+    day_minutes_init(&minutes, words, DIM(week->days));
   }
-  return week_parse_single(week, s, len);
+  if (0 == len || 'P' != *s)
+    return NO;
+  NOD(day_parse_minutes(week ? &minutes : 0, WEEKDAYS, s + 1, len - 1));
+  if (week && !day_from_minutes(week->days, DIM(week->days), &minutes))
+    return NO;
+  return OK;
 }
 
 void week_add_to_schedule(const a_week *week, const a_time *t, a_schedule *schedule)
@@ -196,6 +178,10 @@ static void test_weekly_remaining(void)
   IN("U1-2&3-4.M6-7&8-9",    1,  8,  0,  0,  3600);
   IN("UMTWRFA0-2359",        0,  0,  0,  0,  3600 * 24 - 60);
   IN("MTWRFAU0-2359",        0,  0,  0,  0,  3600 * 24 - 60);
+  IN("P8-9",                 1,  8,  0,  0,  3600);
+  IN("P8-9&10-11",           5, 10, 30,  0,  1800);
+  IN("M9-10.T8-9.M8-9",       1,  8,  0,  0,  7200);
+  IN("U23-24.M0-1",           0, 23,  0,  0,  7200);
 #undef IN
 #define OUT(hrsss, wday, h, m, s, seconds)                            \
   if (thwr_aux(hrsss, wday, h, m, s, 1, 0, seconds)) TFAIL()
@@ -213,6 +199,8 @@ static void test_weekly_remaining(void)
   OUT("U1-2&3-4.M6-7&8-9",    1,  9,  0,  0, 3600 * 24 * 6 - 3600 * 8);
   OUT("UMTWRFA0000-2359",     6, 23, 59, 59,     1);
   OUT("MTWRFAU0-2359",        6, 23, 59, 59,     1);
+  OUT("P8-9",                 5,  9,  0,  0, 3 * 24 * 3600 - 3600);
+  OUT("P8-9",                 0,  8,  0,  0,  24 * 3600);
 #undef OUT
 #define BAD(hrsss) do {                                                 \
     a_time t = time_clone(time_now());                                \
@@ -224,6 +212,13 @@ static void test_weekly_remaining(void)
   BAD("U-");
   BAD("U13-12");
   BAD("X1-2");
+  BAD("P");
+  BAD("P8");
+  BAD("PM8-9");
+  BAD("P8-9.A8-9");
+  BAD("U8-9.");
+  BAD("U8-9..M8-9");
+  BAD("U8-9&");
 #undef BAD
 }
 
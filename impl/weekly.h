@@ -10,6 +10,7 @@ typedef struct a_week {
 } a_week;
 
 status week_init(a_week *week, const char *s, size_t size);
+status week_init_weekdaily(a_week *week, const char *s, size_t len);
 void week_destroy(a_week *week);
 void week_add_to_schedule(const a_week *week, const a_time *t, struct a_schedule *schedule);
 